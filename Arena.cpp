@@ -0,0 +1,30 @@
+#include "Arena.h"
+#include <algorithm>
+#include <cstdint>
+
+using namespace std;
+
+Arena::~Arena() {
+    for (auto it = finalizers.rbegin(); it != finalizers.rend(); ++it) {
+        it->destroy(it->object);
+    }
+}
+
+void* Arena::allocate(size_t size, size_t alignment) {
+    uintptr_t address = reinterpret_cast<uintptr_t>(next);
+    uintptr_t aligned = (address + alignment - 1) & ~(uintptr_t)(alignment - 1);
+
+    if (next == nullptr || aligned + size > reinterpret_cast<uintptr_t>(end)) {
+        // Oversized requests get a block of their own
+        size_t blockSize = max(BLOCK_SIZE, size + alignment);
+        blocks.emplace_back(new char[blockSize]);
+        next = blocks.back().get();
+        end = next + blockSize;
+
+        address = reinterpret_cast<uintptr_t>(next);
+        aligned = (address + alignment - 1) & ~(uintptr_t)(alignment - 1);
+    }
+
+    next = reinterpret_cast<char*>(aligned + size);
+    return reinterpret_cast<void*>(aligned);
+}
@@ -0,0 +1,49 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Bump allocator for the syntax tree of one compilation. Nodes are carved
+// out of large blocks one after another, so a tree is laid out roughly in
+// the order it is walked, and the whole program is freed at once when the
+// arena goes away. Pointers between nodes do not own anything.
+class Arena {
+public:
+    Arena() = default;
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+    ~Arena();
+
+    template<typename T, typename... Args>
+    T* make(Args&&... args) {
+        void* memory = allocate(sizeof(T), alignof(T));
+        T* object = new (memory) T(std::forward<Args>(args)...);
+        if (!std::is_trivially_destructible<T>::value) {
+            finalizers.push_back(Finalizer{object, [](void* p) { static_cast<T*>(p)->~T(); }});
+        }
+        return object;
+    }
+
+private:
+    static constexpr size_t BLOCK_SIZE = 64 * 1024;
+
+    // Nodes still own strings and vectors, so their destructors must run
+    struct Finalizer {
+        void* object;
+        void (*destroy)(void*);
+    };
+
+    std::vector<std::unique_ptr<char[]>> blocks;
+    char* next = nullptr;
+    char* end = nullptr;
+    std::vector<Finalizer> finalizers;
+
+    void* allocate(size_t size, size_t alignment);
+};
+
+#endif // ARENA_H
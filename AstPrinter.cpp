@@ -8,6 +8,18 @@ string AstPrinter::print(Expr* expr) {
     return expr->accept(*this);
 }
 
+string AstPrinter::print(Stmt* stmt) {
+    return stmt->accept(*this);
+}
+
+string AstPrinter::print(const vector<Stmt*>& statements) {
+    string result;
+    for (Stmt* statement : statements) {
+        result += print(statement) + "\n";
+    }
+    return result;
+}
+
 string AstPrinter::visitAssign(Assign* expr) {
     stringstream ss;
     ss << "(= " << expr->name.lexeme << " " << expr->value->accept(*this) << ")";
@@ -17,32 +29,33 @@ string AstPrinter::visitAssign(Assign* expr) {
 string AstPrinter::visitBinary(Binary* expr) {
     // TODO: Implement this method
     // Use the parenthesize helper to format the binary expression
-    return parenthesize(expr->op.lexeme, expr->left.get(), expr->right.get());
+    return parenthesize(string(expr->op.lexeme), expr->left, expr->right);
 }
 
 string AstPrinter::visitGrouping(Grouping* expr) {
     // TODO: Implement this method
     // Use the parenthesize helper to format the grouping expression
-    return parenthesize("group", expr->expression.get());
+    return parenthesize("group", expr->expression);
 }
 
 string AstPrinter::visitLiteralExpr(LiteralExpr* expr) {
-    if (expr->value.isNull()) return "nil";
+    // Quote strings so they can't be mistaken for variables
+    if (expr->value.isString()) return "\"" + expr->value.getString() + "\"";
     return expr->value.toString();
 }
 
 string AstPrinter::visitUnary(Unary* expr) {
     // TODO: Implement this method
     // Use the parenthesize helper to format the unary expression
-    return parenthesize(expr->op.lexeme, expr->right.get());
+    return parenthesize(string(expr->op.lexeme), expr->right);
 }
 
 string AstPrinter::visitVariable(Variable* expr) {
-    return expr->name.lexeme;
+    return string(expr->name.lexeme);
 }
 
 string AstPrinter::visitLogical(Logical* expr) {
-    return parenthesize(expr->op.lexeme, expr->left.get(), expr->right.get());
+    return parenthesize(string(expr->op.lexeme), expr->left, expr->right);
 }
 
 string AstPrinter::visitCall(Call* expr) {
@@ -56,6 +69,48 @@ string AstPrinter::visitCall(Call* expr) {
     return result;
 }
 
+string AstPrinter::visitGet(Get* expr) {
+    return "(. " + expr->object->accept(*this) + " " + string(expr->name.lexeme) + ")";
+}
+
+string AstPrinter::visitSet(Set* expr) {
+    return "(= (. " + expr->object->accept(*this) + " " + string(expr->name.lexeme) + ") " +
+        expr->value->accept(*this) + ")";
+}
+
+string AstPrinter::visitIndex(Index* expr) {
+    return parenthesize("[]", expr->object, expr->index);
+}
+
+string AstPrinter::visitIndexSet(IndexSet* expr) {
+    return "(= ([] " + expr->object->accept(*this) + " " + expr->index->accept(*this) + ") " +
+        expr->value->accept(*this) + ")";
+}
+
+string AstPrinter::visitListLiteral(ListLiteral* expr) {
+    string result = "(list";
+    for (Expr* element : expr->elements) {
+        result += " " + element->accept(*this);
+    }
+    return result + ")";
+}
+
+string AstPrinter::visitMapLiteral(MapLiteral* expr) {
+    string result = "(map";
+    for (size_t i = 0; i < expr->keys.size(); i++) {
+        result += " (" + expr->keys[i]->accept(*this) + " " + expr->values[i]->accept(*this) + ")";
+    }
+    return result + ")";
+}
+
+string AstPrinter::visitSuper(Super* expr) {
+    return "(super " + string(expr->method.lexeme) + ")";
+}
+
+string AstPrinter::visitThis(This*) {
+    return "this";
+}
+
 string AstPrinter::parenthesize(const string& name, Expr* expr) {
     // TODO: Implement this method
     // Create a string that wraps the expression in parentheses with the name
@@ -78,4 +133,80 @@ string AstPrinter::parenthesize(const string& name, Expr* expr1, Expr* expr2) {
     ss << ")";
     return ss.str();
 }
- 
\ No newline at end of file
+ 
+// Statement visitor methods
+string AstPrinter::nested(Stmt* stmt) {
+    depth++;
+    string result = "\n" + string(depth * 2, ' ') + stmt->accept(*this);
+    depth--;
+    return result;
+}
+
+string AstPrinter::visitBlock(Block* stmt) {
+    string result = "(block";
+    for (Stmt* statement : stmt->statements) {
+        result += nested(statement);
+    }
+    return result + ")";
+}
+
+string AstPrinter::visitClass(Class* stmt) {
+    string result = "(class " + string(stmt->name.lexeme);
+    if (stmt->superclass != nullptr) {
+        result += " < " + string(stmt->superclass->name.lexeme);
+    }
+    for (Function* method : stmt->methods) {
+        result += nested(method);
+    }
+    return result + ")";
+}
+
+string AstPrinter::visitExpression(Expression* stmt) {
+    return "(; " + stmt->expression->accept(*this) + ")";
+}
+
+string AstPrinter::visitForEach(ForEach* stmt) {
+    return "(for " + string(stmt->name.lexeme) + " " + stmt->iterable->accept(*this) + nested(stmt->body) + ")";
+}
+
+string AstPrinter::visitFunction(Function* stmt) {
+    string result = "(fun " + string(stmt->name.lexeme) + " (";
+    for (size_t i = 0; i < stmt->params.size(); i++) {
+        if (i > 0) result += " ";
+        result += string(stmt->params[i].lexeme);
+    }
+    result += ")";
+    for (Stmt* statement : stmt->body) {
+        result += nested(statement);
+    }
+    return result + ")";
+}
+
+string AstPrinter::visitIf(If* stmt) {
+    string result = "(if " + stmt->condition->accept(*this) + nested(stmt->thenBranch);
+    if (stmt->elseBranch != nullptr) {
+        result += nested(stmt->elseBranch);
+    }
+    return result + ")";
+}
+
+string AstPrinter::visitPrint(Print* stmt) {
+    return parenthesize("print", stmt->expression);
+}
+
+string AstPrinter::visitReturn(Return* stmt) {
+    if (stmt->value == nullptr) return "(return)";
+    return parenthesize("return", stmt->value);
+}
+
+string AstPrinter::visitVar(Var* stmt) {
+    string result = "(var " + string(stmt->name.lexeme);
+    if (stmt->initializer != nullptr) {
+        result += " " + stmt->initializer->accept(*this);
+    }
+    return result + ")";
+}
+
+string AstPrinter::visitWhile(While* stmt) {
+    return "(while " + stmt->condition->accept(*this) + nested(stmt->body) + ")";
+}
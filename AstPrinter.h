@@ -2,22 +2,53 @@
 #define AST_PRINTER_H
 
 #include <string>
+#include <vector>
 #include "Expr.h"
+#include "Stmt.h"
 
-class AstPrinter : public ExprStringVisitor {
+// Renders syntax trees as S-expressions. Statements that contain other
+// statements (blocks, classes, functions, loops, ifs) put each child on its
+// own indented line.
+class AstPrinter : public ExprStringVisitor, public StmtStringVisitor {
 public:
     std::string print(Expr* expr);
+    std::string print(Stmt* stmt);
+    std::string print(const std::vector<Stmt*>& statements);
 
     std::string visitAssign(Assign* expr) override;
     std::string visitBinary(Binary* expr) override;
     std::string visitCall(Call* expr) override;
+    std::string visitGet(Get* expr) override;
     std::string visitGrouping(Grouping* expr) override;
+    std::string visitIndex(Index* expr) override;
+    std::string visitIndexSet(IndexSet* expr) override;
+    std::string visitListLiteral(ListLiteral* expr) override;
     std::string visitLiteralExpr(LiteralExpr* expr) override;
     std::string visitLogical(Logical* expr) override;
+    std::string visitMapLiteral(MapLiteral* expr) override;
+    std::string visitSet(Set* expr) override;
+    std::string visitSuper(Super* expr) override;
+    std::string visitThis(This* expr) override;
     std::string visitUnary(Unary* expr) override;
     std::string visitVariable(Variable* expr) override;
 
+    std::string visitBlock(Block* stmt) override;
+    std::string visitClass(Class* stmt) override;
+    std::string visitExpression(Expression* stmt) override;
+    std::string visitForEach(ForEach* stmt) override;
+    std::string visitFunction(Function* stmt) override;
+    std::string visitIf(If* stmt) override;
+    std::string visitPrint(Print* stmt) override;
+    std::string visitReturn(Return* stmt) override;
+    std::string visitVar(Var* stmt) override;
+    std::string visitWhile(While* stmt) override;
+
 private:
+    int depth = 0;  // Nesting level of the statement being printed
+
+    // A nested statement on a new line, indented one level deeper
+    std::string nested(Stmt* stmt);
+
     std::string parenthesize(const std::string& name, Expr* expr);
     std::string parenthesize(const std::string& name, Expr* expr1, Expr* expr2);
 };
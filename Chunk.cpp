@@ -0,0 +1,45 @@
+#include "Chunk.h"
+#include "VmFunction.h"
+#include "Heap.h"
+
+using namespace std;
+
+void Chunk::write(uint8_t byte, int line) {
+    code.push_back(byte);
+    lines.push_back(line);
+}
+
+int Chunk::addConstant(const Value& value) {
+    constants.push_back(value);
+    return constants.size() - 1;
+}
+
+int Chunk::addFunction(VmFunction* function) {
+    functions.push_back(function);
+    return functions.size() - 1;
+}
+
+int Chunk::addCache() {
+    caches.emplace_back();
+    return caches.size() - 1;
+}
+
+void VmFunction::trace(Heap& heap) {
+    for (const Value& constant : chunk.constants) {
+        heap.markValue(constant);
+    }
+    for (VmFunction* function : chunk.functions) {
+        heap.markObject(function);
+    }
+}
+
+void VmUpvalue::trace(Heap& heap) {
+    heap.markValue(closed);
+}
+
+void VmClosure::trace(Heap& heap) {
+    heap.markObject(function);
+    for (VmUpvalue* upvalue : upvalues) {
+        heap.markObject(upvalue);
+    }
+}
@@ -0,0 +1,93 @@
+#ifndef CHUNK_H
+#define CHUNK_H
+
+#include <cstdint>
+#include <vector>
+#include "Value.h"
+#include "LoxClass.h"
+
+class VmFunction;
+
+// Every instruction the VM understands. The list is expanded once into the
+// OpCode enum and once into the VM's computed-goto dispatch table, so the two
+// can never get out of order.
+//
+// Operands follow the opcode byte: u8 for local, upvalue and argument counts,
+// big-endian u16 for constant, global, function and cache indices and jump
+// offsets. Property names are string constants.
+#define OPCODE_LIST(X) \
+    X(CONSTANT)        /* u16 constant index */                  \
+    X(NIL)                                                       \
+    X(TRUE)                                                      \
+    X(FALSE)                                                     \
+    X(POP)                                                       \
+    X(GET_LOCAL)       /* u8 frame slot */                       \
+    X(SET_LOCAL)       /* u8 frame slot */                       \
+    X(GET_GLOBAL)      /* u16 global index */                    \
+    X(DEFINE_GLOBAL)   /* u16 global index */                    \
+    X(SET_GLOBAL)      /* u16 global index */                    \
+    X(GET_UPVALUE)     /* u8 upvalue index */                    \
+    X(SET_UPVALUE)     /* u8 upvalue index */                    \
+    X(EQUAL)                                                     \
+    X(NOT_EQUAL)                                                 \
+    X(GREATER)                                                   \
+    X(GREATER_EQUAL)                                             \
+    X(LESS)                                                      \
+    X(LESS_EQUAL)                                                \
+    X(ADD)                                                       \
+    X(SUBTRACT)                                                  \
+    X(MULTIPLY)                                                  \
+    X(DIVIDE)                                                    \
+    X(NOT)                                                       \
+    X(NEGATE)                                                    \
+    X(PRINT)                                                     \
+    X(JUMP)            /* u16 forward offset */                  \
+    X(JUMP_IF_FALSE)   /* u16 forward offset, leaves condition */ \
+    X(JUMP_IF_TRUE)    /* u16 forward offset, leaves condition */ \
+    X(LOOP)            /* u16 backward offset */                 \
+    X(CALL)            /* u8 argument count */                   \
+    X(TAIL_CALL)       /* u8 argument count; calls, then returns in its place */ \
+    X(CLOSURE)         /* u16 function index, then (isLocal, index) per upvalue */ \
+    X(CLOSE_UPVALUE)                                             \
+    X(RETURN)                                                    \
+    X(CLASS)           /* u16 name constant */                   \
+    X(INHERIT)         /* superclass, subclass -> superclass */  \
+    X(METHOD)          /* u16 name constant; class, closure -> class */ \
+    X(GET_PROPERTY)    /* u16 name constant, u16 cache index */  \
+    X(SET_PROPERTY)    /* u16 name constant, u16 cache index */  \
+    X(INVOKE)          /* u16 name constant, u8 argument count, u16 cache index */ \
+    X(TAIL_INVOKE)     /* as INVOKE, then returns in its place */ \
+    X(GET_SUPER)       /* u16 name constant */                   \
+    X(SUPER_INVOKE)    /* u16 name constant, u8 argument count */ \
+    X(LIST)            /* -> new empty list */                   \
+    X(APPEND)          /* u8 element count; list, elements -> list */ \
+    X(MAP)             /* -> new empty map */                    \
+    X(INSERT)          /* u8 entry count; map, key, value pairs -> map */ \
+    X(GET_INDEX)       /* object, index -> element */            \
+    X(SET_INDEX)       /* object, index, value -> value */       \
+    X(ITERATE)         /* list or map -> list a for-each loop walks */ \
+    X(FOR_ITER)        /* u8 frame slot of the list, followed by the position; u16 exit offset */
+
+enum OpCode : uint8_t {
+#define OPCODE_ENUM(name) OP_##name,
+    OPCODE_LIST(OPCODE_ENUM)
+#undef OPCODE_ENUM
+};
+
+// A compiled sequence of bytecode together with the constants, nested
+// function prototypes and property inline caches it refers to
+class Chunk {
+public:
+    std::vector<uint8_t> code;
+    std::vector<int> lines;  // Source line for every byte in code
+    std::vector<Value> constants;
+    std::vector<VmFunction*> functions;
+    std::vector<PropertyCache> caches;  // One per property access site
+
+    void write(uint8_t byte, int line);
+    int addConstant(const Value& value);
+    int addFunction(VmFunction* function);
+    int addCache();
+};
+
+#endif // CHUNK_H
@@ -0,0 +1,616 @@
+#include "Compiler.h"
+#include "VM.h"
+#include "Lox.h"
+
+using namespace std;
+
+// Operand limits imposed by the instruction encoding
+static const int MAX_LOCALS = 256;
+static const int MAX_UPVALUES = 256;
+static const int MAX_SHORT = 65535;
+// Elements or entries of a collection literal pushed before they are added
+static const size_t LITERAL_BATCH = 64;
+
+Compiler::Compiler(VM& vm) : vm(vm), heap(Heap::instance()) {
+    heap.addRootSource(this);
+}
+
+Compiler::~Compiler() {
+    heap.removeRootSource(this);
+}
+
+void Compiler::markRoots(Heap& heap) {
+    for (FunctionState* state = current; state != nullptr; state = state->enclosing) {
+        heap.markObject(state->function);
+    }
+}
+
+VmFunction* Compiler::compile(const vector<Stmt*>& statements) {
+    FunctionState script{nullptr, heap.allocate<VmFunction>("script"), {}, {}, 0};
+    // Slot zero holds the function being called
+    script.locals.push_back(Local{"", 0, false});
+    current = &script;
+
+    for (const auto& statement : statements) {
+        compile(statement);
+    }
+    emitByte(OP_NIL);
+    emitByte(OP_RETURN);
+
+    current = nullptr;
+    return script.function;
+}
+
+void Compiler::compile(Stmt* stmt) {
+    stmt->accept(*this);
+}
+
+void Compiler::compile(Expr* expr) {
+    expr->accept(*this);
+}
+
+// Emitting bytecode
+void Compiler::emitByte(uint8_t byte) {
+    currentChunk().write(byte, line);
+}
+
+void Compiler::emitBytes(uint8_t byte1, uint8_t byte2) {
+    emitByte(byte1);
+    emitByte(byte2);
+}
+
+void Compiler::emitShort(int value) {
+    emitByte((value >> 8) & 0xff);
+    emitByte(value & 0xff);
+}
+
+void Compiler::emitConstant(const Value& value) {
+    int constant = currentChunk().addConstant(value);
+    if (constant > MAX_SHORT) {
+        Lox::error(line, "Too many constants in one chunk.");
+        return;
+    }
+    emitByte(OP_CONSTANT);
+    emitShort(constant);
+}
+
+int Compiler::emitJump(OpCode instruction) {
+    emitByte(instruction);
+    emitShort(0xffff);
+    return currentChunk().code.size() - 2;
+}
+
+void Compiler::patchJump(int offset) {
+    // -2 to adjust for the bytes of the jump offset itself
+    int jump = currentChunk().code.size() - offset - 2;
+    if (jump > MAX_SHORT) {
+        Lox::error(line, "Too much code to jump over.");
+    }
+
+    currentChunk().code[offset] = (jump >> 8) & 0xff;
+    currentChunk().code[offset + 1] = jump & 0xff;
+}
+
+void Compiler::emitReturn() {
+    if (current->isInitializer) {
+        emitBytes(OP_GET_LOCAL, 0);
+    } else {
+        emitByte(OP_NIL);
+    }
+    emitByte(OP_RETURN);
+}
+
+int Compiler::nameConstant(const Token& name) {
+    int constant = currentChunk().addConstant(Value(heap.intern(name.lexeme)));
+    if (constant > MAX_SHORT) {
+        Lox::error(name, "Too many constants in one chunk.");
+        return 0;
+    }
+    return constant;
+}
+
+int Compiler::addCache() {
+    int index = currentChunk().addCache();
+    if (index > MAX_SHORT) {
+        Lox::error(line, "Too many property accesses in one chunk.");
+        return 0;
+    }
+    return index;
+}
+
+void Compiler::emitLoop(int loopStart) {
+    emitByte(OP_LOOP);
+
+    // +2 to skip over the loop instruction's own operand
+    int offset = currentChunk().code.size() - loopStart + 2;
+    if (offset > MAX_SHORT) {
+        Lox::error(line, "Loop body too large.");
+    }
+    emitShort(offset);
+}
+
+// Scopes and variables
+void Compiler::beginScope() {
+    current->scopeDepth++;
+}
+
+void Compiler::endScope() {
+    current->scopeDepth--;
+
+    auto& locals = current->locals;
+    while (!locals.empty() && locals.back().depth > current->scopeDepth) {
+        // Captured locals move into their upvalue instead of being discarded
+        emitByte(locals.back().isCaptured ? OP_CLOSE_UPVALUE : OP_POP);
+        locals.pop_back();
+    }
+}
+
+void Compiler::addLocal(const Token& name) {
+    if (current->locals.size() == MAX_LOCALS) {
+        Lox::error(name, "Too many local variables in function.");
+        return;
+    }
+    current->locals.push_back(Local{name.lexeme, current->scopeDepth, false});
+}
+
+int Compiler::resolveLocal(FunctionState* state, string_view name) {
+    for (int i = state->locals.size() - 1; i >= 0; i--) {
+        if (state->locals[i].name == name) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int Compiler::resolveUpvalue(FunctionState* state, string_view name) {
+    if (state->enclosing == nullptr) return -1;
+
+    int local = resolveLocal(state->enclosing, name);
+    if (local != -1) {
+        state->enclosing->locals[local].isCaptured = true;
+        return addUpvalue(state, static_cast<uint8_t>(local), true);
+    }
+
+    int upvalue = resolveUpvalue(state->enclosing, name);
+    if (upvalue != -1) {
+        return addUpvalue(state, static_cast<uint8_t>(upvalue), false);
+    }
+
+    return -1;
+}
+
+int Compiler::addUpvalue(FunctionState* state, uint8_t index, bool isLocal) {
+    auto& upvalues = state->upvalues;
+    for (size_t i = 0; i < upvalues.size(); i++) {
+        if (upvalues[i].index == index && upvalues[i].isLocal == isLocal) {
+            return i;
+        }
+    }
+
+    if (upvalues.size() == MAX_UPVALUES) {
+        Lox::error(line, "Too many closure variables in function.");
+        return 0;
+    }
+
+    upvalues.push_back(Upvalue{index, isLocal});
+    state->function->upvalueCount = upvalues.size();
+    return upvalues.size() - 1;
+}
+
+int Compiler::globalIndex(const Token& name) {
+    int index = vm.globalSlot(string(name.lexeme));
+    if (index > MAX_SHORT) {
+        Lox::error(name, "Too many global variables.");
+        return 0;
+    }
+    return index;
+}
+
+void Compiler::defineVariable(const Token& name) {
+    if (current->scopeDepth > 0) {
+        // The value is already sitting in the local's stack slot
+        addLocal(name);
+        return;
+    }
+
+    line = name.line;
+    emitByte(OP_DEFINE_GLOBAL);
+    emitShort(globalIndex(name));
+}
+
+// Emits a read of the variable, or a write when assignedValue is given
+void Compiler::namedVariable(const Token& name, Expr* assignedValue) {
+    OpCode getOp, setOp;
+    int arg = resolveLocal(current, name.lexeme);
+    bool wideOperand = false;
+    if (arg != -1) {
+        getOp = OP_GET_LOCAL;
+        setOp = OP_SET_LOCAL;
+    } else if ((arg = resolveUpvalue(current, name.lexeme)) != -1) {
+        getOp = OP_GET_UPVALUE;
+        setOp = OP_SET_UPVALUE;
+    } else {
+        arg = globalIndex(name);
+        getOp = OP_GET_GLOBAL;
+        setOp = OP_SET_GLOBAL;
+        wideOperand = true;
+    }
+
+    if (assignedValue != nullptr) {
+        compile(assignedValue);
+    }
+
+    line = name.line;
+    emitByte(assignedValue != nullptr ? setOp : getOp);
+    if (wideOperand) {
+        emitShort(arg);
+    } else {
+        emitByte(static_cast<uint8_t>(arg));
+    }
+}
+
+void Compiler::function(Function* stmt) {
+    FunctionState state{current, heap.allocate<VmFunction>(string(stmt->name.lexeme)), {}, {}, 0};
+    state.function->arity = stmt->params.size();
+    state.isInitializer = stmt->isInitializer();
+    // Slot zero holds the receiver in methods and the callee otherwise
+    state.locals.push_back(Local{stmt->isMethod ? "this" : "", 0, false});
+    current = &state;
+
+    // Parameters and body share one scope, as in the Resolver
+    beginScope();
+    for (const Token& param : stmt->params) {
+        addLocal(param);
+    }
+    for (const auto& statement : stmt->body) {
+        compile(statement);
+    }
+
+    // Implicit "return nil" (or "return this") if the body falls off the end
+    emitReturn();
+
+    current = state.enclosing;
+    line = stmt->name.line;
+    int index = currentChunk().addFunction(state.function);
+    emitByte(OP_CLOSURE);
+    emitShort(index);
+    for (const Upvalue& upvalue : state.upvalues) {
+        emitBytes(upvalue.isLocal ? 1 : 0, upvalue.index);
+    }
+}
+
+// Statement visitors
+void Compiler::visitBlock(Block* stmt) {
+    beginScope();
+    for (const auto& statement : stmt->statements) {
+        compile(statement);
+    }
+    endScope();
+}
+
+void Compiler::visitClass(Class* stmt) {
+    line = stmt->name.line;
+    emitByte(OP_CLASS);
+    emitShort(nameConstant(stmt->name));
+    defineVariable(stmt->name);
+
+    if (stmt->superclass != nullptr) {
+        compile(stmt->superclass);
+
+        // The superclass stays on the stack as a local named "super" for
+        // the methods to capture
+        beginScope();
+        addLocal(Token(SUPER, "super", Value(), stmt->name.line));
+
+        namedVariable(stmt->name, nullptr);
+        emitByte(OP_INHERIT);
+    }
+
+    // Methods are attached with the class on top of the stack
+    namedVariable(stmt->name, nullptr);
+    for (Function* method : stmt->methods) {
+        function(method);
+        line = method->name.line;
+        emitByte(OP_METHOD);
+        emitShort(nameConstant(method->name));
+    }
+    emitByte(OP_POP);
+
+    if (stmt->superclass != nullptr) {
+        endScope();
+    }
+}
+
+void Compiler::visitExpression(Expression* stmt) {
+    compile(stmt->expression);
+    emitByte(OP_POP);
+}
+
+void Compiler::visitForEach(ForEach* stmt) {
+    // The list being walked and the position in it live in hidden locals,
+    // named so no Lox code can refer to them
+    beginScope();
+    compile(stmt->iterable);
+    line = stmt->name.line;
+    emitByte(OP_ITERATE);
+    int listSlot = current->locals.size();
+    addLocal(Token(IDENTIFIER, " list", Value(), line));
+    emitConstant(Value(0.0));
+    addLocal(Token(IDENTIFIER, " position", Value(), line));
+
+    // Pushes the next element, or leaves the loop when there is none
+    int loopStart = currentChunk().code.size();
+    emitBytes(OP_FOR_ITER, static_cast<uint8_t>(listSlot));
+    emitShort(0xffff);
+    int exitJump = currentChunk().code.size() - 2;
+
+    // The element is already in the loop variable's slot
+    beginScope();
+    addLocal(stmt->name);
+    compile(stmt->body);
+    endScope();
+    emitLoop(loopStart);
+
+    patchJump(exitJump);
+    endScope();
+}
+
+void Compiler::visitFunction(Function* stmt) {
+    if (current->scopeDepth > 0) {
+        // Declare the local first so the body can refer to itself
+        addLocal(stmt->name);
+        function(stmt);
+    } else {
+        function(stmt);
+        defineVariable(stmt->name);
+    }
+}
+
+void Compiler::visitIf(If* stmt) {
+    compile(stmt->condition);
+
+    int thenJump = emitJump(OP_JUMP_IF_FALSE);
+    emitByte(OP_POP);
+    compile(stmt->thenBranch);
+
+    int elseJump = emitJump(OP_JUMP);
+    patchJump(thenJump);
+    emitByte(OP_POP);
+    if (stmt->elseBranch != nullptr) {
+        compile(stmt->elseBranch);
+    }
+    patchJump(elseJump);
+}
+
+void Compiler::visitPrint(Print* stmt) {
+    compile(stmt->expression);
+    emitByte(OP_PRINT);
+}
+
+void Compiler::visitReturn(Return* stmt) {
+    line = stmt->keyword.line;
+    if (stmt->value == nullptr) {
+        emitReturn();
+        return;
+    }
+
+    if (stmt->tailCall != nullptr) {
+        call(stmt->tailCall, true);
+        return;
+    }
+
+    compile(stmt->value);
+    line = stmt->keyword.line;
+    emitByte(OP_RETURN);
+}
+
+void Compiler::visitVar(Var* stmt) {
+    if (stmt->initializer != nullptr) {
+        compile(stmt->initializer);
+    } else {
+        emitByte(OP_NIL);
+    }
+    defineVariable(stmt->name);
+}
+
+void Compiler::visitWhile(While* stmt) {
+    int loopStart = currentChunk().code.size();
+    compile(stmt->condition);
+
+    int exitJump = emitJump(OP_JUMP_IF_FALSE);
+    emitByte(OP_POP);
+    compile(stmt->body);
+    emitLoop(loopStart);
+
+    patchJump(exitJump);
+    emitByte(OP_POP);
+}
+
+// Expression visitors
+void Compiler::visitAssign(Assign* expr) {
+    namedVariable(expr->name, expr->value);
+}
+
+void Compiler::visitBinary(Binary* expr) {
+    compile(expr->left);
+    compile(expr->right);
+
+    line = expr->op.line;
+    switch (expr->op.type) {
+        case MINUS:         emitByte(OP_SUBTRACT); break;
+        case SLASH:         emitByte(OP_DIVIDE); break;
+        case STAR:          emitByte(OP_MULTIPLY); break;
+        case PLUS:          emitByte(OP_ADD); break;
+        case GREATER:       emitByte(OP_GREATER); break;
+        case GREATER_EQUAL: emitByte(OP_GREATER_EQUAL); break;
+        case LESS:          emitByte(OP_LESS); break;
+        case LESS_EQUAL:    emitByte(OP_LESS_EQUAL); break;
+        case BANG_EQUAL:    emitByte(OP_NOT_EQUAL); break;
+        case EQUAL_EQUAL:   emitByte(OP_EQUAL); break;
+        default:
+            // Unreachable - Parser ensures only valid binary operators are used
+            break;
+    }
+}
+
+void Compiler::visitCall(Call* expr) {
+    call(expr, false);
+}
+
+void Compiler::call(Call* expr, bool tail) {
+    uint8_t argCount = static_cast<uint8_t>(expr->arguments.size());
+
+    // obj.name(...) runs the method on the receiver without binding it
+    if (Get* get = expr->methodCallee) {
+        compile(get->object);
+        for (const auto& argument : expr->arguments) {
+            compile(argument);
+        }
+        line = get->name.line;
+        emitByte(tail ? OP_TAIL_INVOKE : OP_INVOKE);
+        emitShort(nameConstant(get->name));
+        emitByte(argCount);
+        emitShort(addCache());
+        return;
+    }
+
+    if (Super* super = expr->superCallee) {
+        namedVariable(Token(THIS, "this", Value(), super->keyword.line), nullptr);
+        for (const auto& argument : expr->arguments) {
+            compile(argument);
+        }
+        namedVariable(super->keyword, nullptr);
+        line = super->method.line;
+        emitByte(OP_SUPER_INVOKE);
+        emitShort(nameConstant(super->method));
+        emitByte(argCount);
+        // Rare enough in tail position to keep as a plain call
+        if (tail) emitByte(OP_RETURN);
+        return;
+    }
+
+    compile(expr->callee);
+    for (const auto& argument : expr->arguments) {
+        compile(argument);
+    }
+
+    line = expr->paren.line;
+    emitBytes(tail ? OP_TAIL_CALL : OP_CALL, argCount);
+}
+
+void Compiler::visitGet(Get* expr) {
+    compile(expr->object);
+    line = expr->name.line;
+    emitByte(OP_GET_PROPERTY);
+    emitShort(nameConstant(expr->name));
+    emitShort(addCache());
+}
+
+void Compiler::visitSet(Set* expr) {
+    compile(expr->object);
+    compile(expr->value);
+    line = expr->name.line;
+    emitByte(OP_SET_PROPERTY);
+    emitShort(nameConstant(expr->name));
+    emitShort(addCache());
+}
+
+void Compiler::visitIndex(Index* expr) {
+    compile(expr->object);
+    compile(expr->index);
+    line = expr->bracket.line;
+    emitByte(OP_GET_INDEX);
+}
+
+void Compiler::visitIndexSet(IndexSet* expr) {
+    compile(expr->object);
+    compile(expr->index);
+    compile(expr->value);
+    line = expr->bracket.line;
+    emitByte(OP_SET_INDEX);
+}
+
+// Literals are filled in batches so a long one never needs more than a
+// batch's worth of stack
+void Compiler::visitListLiteral(ListLiteral* expr) {
+    line = expr->bracket.line;
+    emitByte(OP_LIST);
+    const auto& elements = expr->elements;
+    for (size_t batch = 0; batch < elements.size(); batch += LITERAL_BATCH) {
+        size_t end = min(elements.size(), batch + LITERAL_BATCH);
+        for (size_t i = batch; i < end; i++) {
+            compile(elements[i]);
+        }
+        line = expr->bracket.line;
+        emitBytes(OP_APPEND, static_cast<uint8_t>(end - batch));
+    }
+}
+
+void Compiler::visitMapLiteral(MapLiteral* expr) {
+    line = expr->brace.line;
+    emitByte(OP_MAP);
+    for (size_t batch = 0; batch < expr->keys.size(); batch += LITERAL_BATCH) {
+        size_t end = min(expr->keys.size(), batch + LITERAL_BATCH);
+        for (size_t i = batch; i < end; i++) {
+            compile(expr->keys[i]);
+            compile(expr->values[i]);
+        }
+        line = expr->brace.line;
+        emitBytes(OP_INSERT, static_cast<uint8_t>(end - batch));
+    }
+}
+
+void Compiler::visitSuper(Super* expr) {
+    namedVariable(Token(THIS, "this", Value(), expr->keyword.line), nullptr);
+    namedVariable(expr->keyword, nullptr);
+    line = expr->method.line;
+    emitByte(OP_GET_SUPER);
+    emitShort(nameConstant(expr->method));
+}
+
+void Compiler::visitThis(This* expr) {
+    namedVariable(expr->keyword, nullptr);
+}
+
+void Compiler::visitGrouping(Grouping* expr) {
+    compile(expr->expression);
+}
+
+void Compiler::visitLiteralExpr(LiteralExpr* expr) {
+    const Value& value = expr->value;
+    if (value.isNil()) {
+        emitByte(OP_NIL);
+    } else if (value.isBoolean()) {
+        emitByte(value.getBoolean() ? OP_TRUE : OP_FALSE);
+    } else {
+        emitConstant(value);
+    }
+}
+
+void Compiler::visitLogical(Logical* expr) {
+    compile(expr->left);
+
+    // Short-circuit: keep the left operand if it decides the result
+    line = expr->op.line;
+    int endJump = emitJump(expr->op.type == OR ? OP_JUMP_IF_TRUE : OP_JUMP_IF_FALSE);
+    emitByte(OP_POP);
+    compile(expr->right);
+    patchJump(endJump);
+}
+
+void Compiler::visitUnary(Unary* expr) {
+    compile(expr->right);
+
+    line = expr->op.line;
+    switch (expr->op.type) {
+        case MINUS: emitByte(OP_NEGATE); break;
+        case BANG:  emitByte(OP_NOT); break;
+        default:
+            // Unreachable - Parser ensures only MINUS and BANG are used for unary operators
+            break;
+    }
+}
+
+void Compiler::visitVariable(Variable* expr) {
+    namedVariable(expr->name, nullptr);
+}
@@ -0,0 +1,118 @@
+#ifndef COMPILER_H
+#define COMPILER_H
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "Expr.h"
+#include "Stmt.h"
+#include "Chunk.h"
+#include "VmFunction.h"
+#include "Heap.h"
+
+class VM;
+
+// Lowers a resolved syntax tree into bytecode for the VM. Scoping errors
+// have already been reported by the Resolver; the compiler only lays out
+// locals in stack slots and works out which ones closures capture.
+class Compiler : public VoidExprVisitor, public StmtVisitor<void>, public GcRootSource {
+    public:
+        Compiler(VM& vm);
+        ~Compiler();
+
+        // Compiles a whole program into the implicit top-level function
+        VmFunction* compile(const std::vector<Stmt*>& statements);
+
+        // Statement visitors
+        void visitBlock(Block* stmt) override;
+        void visitClass(Class* stmt) override;
+        void visitExpression(Expression* stmt) override;
+        void visitForEach(ForEach* stmt) override;
+        void visitFunction(Function* stmt) override;
+        void visitIf(If* stmt) override;
+        void visitPrint(Print* stmt) override;
+        void visitReturn(Return* stmt) override;
+        void visitVar(Var* stmt) override;
+        void visitWhile(While* stmt) override;
+
+        // Expression visitors
+        void visitAssign(Assign* expr) override;
+        void visitBinary(Binary* expr) override;
+        void visitCall(Call* expr) override;
+        void visitGet(Get* expr) override;
+        void visitGrouping(Grouping* expr) override;
+        void visitIndex(Index* expr) override;
+        void visitIndexSet(IndexSet* expr) override;
+        void visitListLiteral(ListLiteral* expr) override;
+        void visitLiteralExpr(LiteralExpr* expr) override;
+        void visitLogical(Logical* expr) override;
+        void visitMapLiteral(MapLiteral* expr) override;
+        void visitSet(Set* expr) override;
+        void visitSuper(Super* expr) override;
+        void visitThis(This* expr) override;
+        void visitUnary(Unary* expr) override;
+        void visitVariable(Variable* expr) override;
+
+        // The functions still being compiled
+        void markRoots(Heap& heap) override;
+
+    private:
+        struct Local {
+            std::string_view name;
+            int depth;
+            bool isCaptured;
+        };
+
+        struct Upvalue {
+            uint8_t index;
+            bool isLocal;
+        };
+
+        // Per-function compilation state, chained to the enclosing function
+        struct FunctionState {
+            FunctionState* enclosing;
+            VmFunction* function;
+            std::vector<Local> locals;
+            std::vector<Upvalue> upvalues;
+            int scopeDepth = 0;
+            bool isInitializer = false;  // Returns "this" from slot zero
+        };
+
+        VM& vm;
+        Heap& heap;
+        FunctionState* current = nullptr;
+        int line = 1;  // Line attached to emitted bytes
+
+        void compile(Stmt* stmt);
+        void compile(Expr* expr);
+        Chunk& currentChunk() { return current->function->chunk; }
+
+        // Emitting bytecode
+        void emitByte(uint8_t byte);
+        void emitBytes(uint8_t byte1, uint8_t byte2);
+        void emitShort(int value);
+        void emitConstant(const Value& value);
+        int emitJump(OpCode instruction);
+        void patchJump(int offset);
+        void emitLoop(int loopStart);
+        void emitReturn();
+        int nameConstant(const Token& name);
+        int addCache();
+
+        // Scopes and variables
+        void beginScope();
+        void endScope();
+        void addLocal(const Token& name);
+        int resolveLocal(FunctionState* state, std::string_view name);
+        int resolveUpvalue(FunctionState* state, std::string_view name);
+        int addUpvalue(FunctionState* state, uint8_t index, bool isLocal);
+        int globalIndex(const Token& name);
+        void defineVariable(const Token& name);
+        void namedVariable(const Token& name, Expr* assignedValue);
+        void function(Function* stmt);
+        // A call in tail position replaces the running function's frame
+        void call(Call* expr, bool tail);
+};
+
+#endif // COMPILER_H
@@ -1,34 +1,36 @@
 #include "Environment.h"
 #include "Interpreter.h" // For RuntimeError
+#include "Heap.h"
 
 using namespace std;
 
-Environment::Environment() {
+Environment::Environment() : Obj(OBJ_ENVIRONMENT) {
     enclosing = nullptr;
 }
 
-Environment::Environment(Environment& enclosing) {
-    this->enclosing = &enclosing;
-}
+Environment::Environment(Environment* enclosing, int slotCount)
+    : Obj(OBJ_ENVIRONMENT), slots(slotCount), enclosing(enclosing) {}
 
-void Environment::define(std::string name, Value value) {
+void Environment::define(string_view name, const Value& value) {
     values[name] = value;
 }
 
-Value Environment::get(Token name) {
-    if(values.count(name.lexeme) > 0) {
-        return values[name.lexeme];
+Value Environment::get(const Token& name) {
+    auto it = values.find(name.lexeme);
+    if(it != values.end()) {
+        return it->second;
     }
 
     if(enclosing != nullptr) 
         return enclosing->get(name);
     
-    throw RuntimeError(name, "Undefined variable '" + name.lexeme + "'.");
+    throw RuntimeError(name, "Undefined variable '" + string(name.lexeme) + "'.");
 }
 
-void Environment::assign(Token name, Value value) {
-    if(values.count(name.lexeme) > 0) {
-        values[name.lexeme] = value;
+void Environment::assign(const Token& name, const Value& value) {
+    auto it = values.find(name.lexeme);
+    if(it != values.end()) {
+        it->second = value;
         return;
     }
 
@@ -37,7 +39,17 @@ void Environment::assign(Token name, Value value) {
         return;
     }
     
-    throw RuntimeError(name, "Undefined variable '" + name.lexeme + "'.");
+    throw RuntimeError(name, "Undefined variable '" + string(name.lexeme) + "'.");
+}
+
+void Environment::trace(Heap& heap) {
+    for (const Value& value : slots) {
+        heap.markValue(value);
+    }
+    for (const auto& entry : values) {
+        heap.markValue(entry.second);
+    }
+    heap.markObject(enclosing);
 }
 
 Environment* Environment::ancestor(int distance) {
@@ -47,11 +59,3 @@ Environment* Environment::ancestor(int distance) {
     }
     return environment;
 }
-
-Value Environment::getAt(int distance, const std::string& name) {
-    return ancestor(distance)->values[name];
-}
-
-void Environment::assignAt(int distance, Token name, Value value) {
-    ancestor(distance)->values[name.lexeme] = value;
-}
\ No newline at end of file
@@ -2,29 +2,46 @@
 #define ENVIRONMENT_H
 
 #include <string>
+#include <string_view>
+#include <vector>
 #include <unordered_map>
+#include "Object.h"
 #include "Value.h"
 #include "Token.h"
 
 // Forward declare RuntimeError
 class RuntimeError;
 
-class Environment {
+// Environments live on the garbage-collected Heap: a block or call uses its
+// environment while it runs, and every closure created inside keeps it
+// reachable afterwards
+class Environment : public Obj {
     private:
-        std::unordered_map<std::string, Value> values;
+        // Locals live in slots numbered by the Resolver; only the global
+        // environment is looked up by name
+        std::vector<Value> slots;
+        // Global names are views into the program source (or static strings
+        // for built-ins), which outlive the environment
+        std::unordered_map<std::string_view, Value> values;
         Environment* enclosing;
 
     public:
         Environment();
-        Environment(Environment& enclosing);
-        void define(std::string name, Value value);
-        Value get(Token name);
-        void assign(Token name, Value value);
+        Environment(Environment* enclosing, int slotCount);
+
+        // Global (name-keyed) bindings
+        void define(std::string_view name, const Value& value);
+        Value get(const Token& name);
+        void assign(const Token& name, const Value& value);
         
-        // New methods for resolver
+        // Local (slot-indexed) bindings resolved by the Resolver
+        void defineAt(int slot, const Value& value) { slots[slot] = value; }
         Environment* ancestor(int distance);
-        Value getAt(int distance, const std::string& name);
-        void assignAt(int distance, Token name, Value value);
+        const Value& getAt(int distance, int slot) { return ancestor(distance)->slots[slot]; }
+        void assignAt(int distance, int slot, const Value& value) { ancestor(distance)->slots[slot] = value; }
+
+        void trace(Heap& heap) override;
+        size_t extraSize() const override { return slots.capacity() * sizeof(Value); }
 };
 
-#endif // ENVIRONMENT_H
\ No newline at end of file
+#endif // ENVIRONMENT_H
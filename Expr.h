@@ -1,21 +1,26 @@
 #ifndef Expr_H
 #define Expr_H
 
-#include <memory>
 #include <vector>
 #include <string>
 #include "Token.h"
-#include "Literal.h"
 #include "Value.h"
-
-using std::shared_ptr;
+#include "LoxClass.h"
 
 class Assign;
 class Binary;
 class Call;
+class Get;
 class Grouping;
+class Index;
+class IndexSet;
+class ListLiteral;
 class LiteralExpr;
 class Logical;
+class MapLiteral;
+class Set;
+class Super;
+class This;
 class Variable;
 class Unary;
 
@@ -27,9 +32,17 @@ public:
     virtual R visitAssign(Assign* expr) = 0;
     virtual R visitBinary(Binary* expr) = 0;
     virtual R visitCall(Call* expr) = 0;
+    virtual R visitGet(Get* expr) = 0;
     virtual R visitGrouping(Grouping* expr) = 0;
+    virtual R visitIndex(Index* expr) = 0;
+    virtual R visitIndexSet(IndexSet* expr) = 0;
+    virtual R visitListLiteral(ListLiteral* expr) = 0;
     virtual R visitLiteralExpr(LiteralExpr* expr) = 0;
     virtual R visitLogical(Logical* expr) = 0;
+    virtual R visitMapLiteral(MapLiteral* expr) = 0;
+    virtual R visitSet(Set* expr) = 0;
+    virtual R visitSuper(Super* expr) = 0;
+    virtual R visitThis(This* expr) = 0;
     virtual R visitVariable(Variable* expr) = 0;
     virtual R visitUnary(Unary* expr) = 0;
 };
@@ -39,7 +52,8 @@ using ExprStringVisitor = ExprVisitor<std::string>;
 using ValueVisitor = ExprVisitor<Value>;
 using VoidExprVisitor = ExprVisitor<void>;
 
-// Base expression class
+// Base expression class. Nodes are allocated in the Parser's Arena, which
+// owns them; child pointers do not own anything.
 class Expr {
 public:
     virtual ~Expr() = default;
@@ -50,7 +64,7 @@ public:
 
 class Assign : public Expr {
 public:
-    Assign(const Token& name, const shared_ptr<Expr>& value) : name(name), value(value) {}
+    Assign(const Token& name, Expr* value) : name(name), value(value) {}
 
     std::string accept(ExprStringVisitor& visitor) override {
         return visitor.visitAssign(this);
@@ -66,12 +80,17 @@ public:
 
     // Fields
     Token name;
-    shared_ptr<Expr> value;
+    Expr* value;
+
+    // Filled in by the Resolver; depth -1 means the variable is global
+    int depth = -1;
+    int slot = -1;
+    bool inFrame = false;  // The slot is in the running call's frame; depth is unused
 };
 
 class Binary : public Expr {
 public:
-    Binary(const shared_ptr<Expr>& left, const Token& op, const shared_ptr<Expr>& right) : left(left), op(op), right(right) {}
+    Binary(Expr* left, const Token& op, Expr* right) : left(left), op(op), right(right) {}
 
     std::string accept(ExprStringVisitor& visitor) override {
         return visitor.visitBinary(this);
@@ -86,14 +105,33 @@ public:
     }
 
     // Fields
-    shared_ptr<Expr> left;
+    Expr* left;
     Token op;
-    shared_ptr<Expr> right;
+    Expr* right;
+
+    // How the Interpreter evaluates this node, rewritten the first time it
+    // runs. The number forms check both operands with a single guard and
+    // skip the per-operator type checks. The first operands that fail the
+    // guard send the node back to GENERIC for good, so a node that sees
+    // mixed types doesn't keep flipping between forms.
+    enum class Form : uint8_t {
+        UNQUICKENED,
+        GENERIC,
+        NUMBER_ADD,
+        NUMBER_SUBTRACT,
+        NUMBER_MULTIPLY,
+        NUMBER_DIVIDE,
+        NUMBER_GREATER,
+        NUMBER_GREATER_EQUAL,
+        NUMBER_LESS,
+        NUMBER_LESS_EQUAL,
+    };
+    Form form = Form::UNQUICKENED;
 };
 
 class Call : public Expr {
 public:
-    Call(const shared_ptr<Expr>& callee, const Token& paren, const std::vector<shared_ptr<Expr>>& arguments) : callee(callee), paren(paren), arguments(arguments) {}
+    Call(Expr* callee, const Token& paren, const std::vector<Expr*>& arguments) : callee(callee), paren(paren), arguments(arguments) {}
 
     std::string accept(ExprStringVisitor& visitor) override {
         return visitor.visitCall(this);
@@ -108,14 +146,43 @@ public:
     }
 
     // Fields
-    shared_ptr<Expr> callee;
+    Expr* callee;
     Token paren;
-    std::vector<shared_ptr<Expr>> arguments;
+    std::vector<Expr*> arguments;
+
+    // Set by the Parser when the callee is obj.name or super.name. Such
+    // methods are called with their receiver instead of being bound first.
+    Get* methodCallee = nullptr;
+    Super* superCallee = nullptr;
+};
+
+class Get : public Expr {
+public:
+    Get(Expr* object, const Token& name) : object(object), name(name) {}
+
+    std::string accept(ExprStringVisitor& visitor) override {
+        return visitor.visitGet(this);
+    }
+
+    Value accept(ValueVisitor& visitor) override {
+        return visitor.visitGet(this);
+    }
+    
+    void accept(VoidExprVisitor& visitor) override {
+        visitor.visitGet(this);
+    }
+
+    // Fields
+    Expr* object;
+    Token name;
+
+    // Inline cache used by the Interpreter
+    PropertyCache cache;
 };
 
 class Grouping : public Expr {
 public:
-    Grouping(const shared_ptr<Expr>& expression) : expression(expression) {}
+    Grouping(Expr* expression) : expression(expression) {}
 
     std::string accept(ExprStringVisitor& visitor) override {
         return visitor.visitGrouping(this);
@@ -130,12 +197,78 @@ public:
     }
 
     // Fields
-    shared_ptr<Expr> expression;
+    Expr* expression;
+};
+
+class Index : public Expr {
+public:
+    Index(Expr* object, const Token& bracket, Expr* index) : object(object), bracket(bracket), index(index) {}
+
+    std::string accept(ExprStringVisitor& visitor) override {
+        return visitor.visitIndex(this);
+    }
+
+    Value accept(ValueVisitor& visitor) override {
+        return visitor.visitIndex(this);
+    }
+    
+    void accept(VoidExprVisitor& visitor) override {
+        visitor.visitIndex(this);
+    }
+
+    // Fields
+    Expr* object;
+    Token bracket;  // The closing bracket, for runtime errors
+    Expr* index;
+};
+
+class IndexSet : public Expr {
+public:
+    IndexSet(Expr* object, const Token& bracket, Expr* index, Expr* value) : object(object), bracket(bracket), index(index), value(value) {}
+
+    std::string accept(ExprStringVisitor& visitor) override {
+        return visitor.visitIndexSet(this);
+    }
+
+    Value accept(ValueVisitor& visitor) override {
+        return visitor.visitIndexSet(this);
+    }
+    
+    void accept(VoidExprVisitor& visitor) override {
+        visitor.visitIndexSet(this);
+    }
+
+    // Fields
+    Expr* object;
+    Token bracket;
+    Expr* index;
+    Expr* value;
+};
+
+class ListLiteral : public Expr {
+public:
+    ListLiteral(const Token& bracket, const std::vector<Expr*>& elements) : bracket(bracket), elements(elements) {}
+
+    std::string accept(ExprStringVisitor& visitor) override {
+        return visitor.visitListLiteral(this);
+    }
+
+    Value accept(ValueVisitor& visitor) override {
+        return visitor.visitListLiteral(this);
+    }
+    
+    void accept(VoidExprVisitor& visitor) override {
+        visitor.visitListLiteral(this);
+    }
+
+    // Fields
+    Token bracket;
+    std::vector<Expr*> elements;
 };
 
 class LiteralExpr : public Expr {
 public:
-    LiteralExpr(Literal value) : value(value) {}
+    LiteralExpr(const Value& value) : value(value) {}
 
     std::string accept(ExprStringVisitor& visitor) override {
         return visitor.visitLiteralExpr(this);
@@ -150,12 +283,12 @@ public:
     }
 
     // Fields
-    Literal value;
+    Value value;  // Strings are interned when the literal is scanned or folded
 };
 
 class Logical : public Expr {
 public:
-    Logical(const shared_ptr<Expr>& left, const Token& op, const shared_ptr<Expr>& right) : left(left), op(op), right(right) {}
+    Logical(Expr* left, const Token& op, Expr* right) : left(left), op(op), right(right) {}
 
     std::string accept(ExprStringVisitor& visitor) override {
         return visitor.visitLogical(this);
@@ -170,9 +303,109 @@ public:
     }
 
     // Fields
-    shared_ptr<Expr> left;
+    Expr* left;
     Token op;
-    shared_ptr<Expr> right;
+    Expr* right;
+};
+
+class MapLiteral : public Expr {
+public:
+    MapLiteral(const Token& brace, const std::vector<Expr*>& keys, const std::vector<Expr*>& values) : brace(brace), keys(keys), values(values) {}
+
+    std::string accept(ExprStringVisitor& visitor) override {
+        return visitor.visitMapLiteral(this);
+    }
+
+    Value accept(ValueVisitor& visitor) override {
+        return visitor.visitMapLiteral(this);
+    }
+    
+    void accept(VoidExprVisitor& visitor) override {
+        visitor.visitMapLiteral(this);
+    }
+
+    // Fields
+    Token brace;
+    std::vector<Expr*> keys;
+    std::vector<Expr*> values;  // values[i] goes with keys[i]
+};
+
+class Set : public Expr {
+public:
+    Set(Expr* object, const Token& name, Expr* value) : object(object), name(name), value(value) {}
+
+    std::string accept(ExprStringVisitor& visitor) override {
+        return visitor.visitSet(this);
+    }
+
+    Value accept(ValueVisitor& visitor) override {
+        return visitor.visitSet(this);
+    }
+    
+    void accept(VoidExprVisitor& visitor) override {
+        visitor.visitSet(this);
+    }
+
+    // Fields
+    Expr* object;
+    Token name;
+    Expr* value;
+
+    // Inline cache used by the Interpreter
+    PropertyCache cache;
+};
+
+class Super : public Expr {
+public:
+    Super(const Token& keyword, const Token& method) : keyword(keyword), method(method) {}
+
+    std::string accept(ExprStringVisitor& visitor) override {
+        return visitor.visitSuper(this);
+    }
+
+    Value accept(ValueVisitor& visitor) override {
+        return visitor.visitSuper(this);
+    }
+    
+    void accept(VoidExprVisitor& visitor) override {
+        visitor.visitSuper(this);
+    }
+
+    // Fields
+    Token keyword;
+    Token method;
+
+    // Filled in by the Resolver: where "super" and the receiver "this" live
+    int depth = -1;
+    int slot = -1;
+    int thisDepth = -1;
+    int thisSlot = -1;
+    bool thisInFrame = false;
+};
+
+class This : public Expr {
+public:
+    This(const Token& keyword) : keyword(keyword) {}
+
+    std::string accept(ExprStringVisitor& visitor) override {
+        return visitor.visitThis(this);
+    }
+
+    Value accept(ValueVisitor& visitor) override {
+        return visitor.visitThis(this);
+    }
+    
+    void accept(VoidExprVisitor& visitor) override {
+        visitor.visitThis(this);
+    }
+
+    // Fields
+    Token keyword;
+
+    // Filled in by the Resolver
+    int depth = -1;
+    int slot = -1;
+    bool inFrame = false;  // The slot is in the running call's frame; depth is unused
 };
 
 class Variable : public Expr {
@@ -193,11 +426,16 @@ public:
 
     // Fields
     Token name;
+
+    // Filled in by the Resolver; depth -1 means the variable is global
+    int depth = -1;
+    int slot = -1;
+    bool inFrame = false;  // The slot is in the running call's frame; depth is unused
 };
 
 class Unary : public Expr {
 public:
-    Unary(const Token& op, const shared_ptr<Expr>& right) : op(op), right(right) {}
+    Unary(const Token& op, Expr* right) : op(op), right(right) {}
 
     std::string accept(ExprStringVisitor& visitor) override {
         return visitor.visitUnary(this);
@@ -213,7 +451,7 @@ public:
 
     // Fields
     Token op;
-    shared_ptr<Expr> right;
+    Expr* right;
 };
 
 #endif // Expr_H
@@ -0,0 +1,147 @@
+#include "Heap.h"
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+
+using namespace std;
+
+// Define to collect before every allocation, which shakes out missing roots
+// #define DEBUG_STRESS_GC
+
+Heap& Heap::instance() {
+    static Heap heap;
+    return heap;
+}
+
+Heap::~Heap() {
+    Obj* object = objects;
+    while (object != nullptr) {
+        Obj* next = object->next;
+        delete object;
+        object = next;
+    }
+}
+
+void Heap::track(Obj* object, size_t baseSize) {
+    object->size = baseSize + object->extraSize();
+    object->next = objects;
+    objects = object;
+
+    bytesAllocated += object->size;
+    stats.bytesAllocated += object->size;
+    stats.objectsAllocated++;
+    stats.peakHeapBytes = max(stats.peakHeapBytes, bytesAllocated);
+}
+
+void Heap::charge(Obj* object, size_t bytes) {
+    object->size += bytes;
+    bytesAllocated += bytes;
+    stats.bytesAllocated += bytes;
+    stats.peakHeapBytes = max(stats.peakHeapBytes, bytesAllocated);
+}
+
+bool Heap::stressCollect() const {
+#ifdef DEBUG_STRESS_GC
+    return true;
+#else
+    return false;
+#endif
+}
+
+ObjString* Heap::intern(string_view chars) {
+    uint32_t hash = ObjString::hashChars(chars);
+    if (ObjString* existing = strings.find(chars, hash)) return existing;
+
+    ObjString* interned = allocate<ObjString>(string(chars), hash);
+    strings.insert(interned);
+    return interned;
+}
+
+ObjString* Heap::intern(std::string&& chars) {
+    uint32_t hash = ObjString::hashChars(chars);
+    if (ObjString* existing = strings.find(chars, hash)) return existing;
+
+    ObjString* interned = allocate<ObjString>(std::move(chars), hash);
+    strings.insert(interned);
+    return interned;
+}
+
+void Heap::addRootSource(GcRootSource* source) {
+    rootSources.push_back(source);
+}
+
+void Heap::removeRootSource(GcRootSource* source) {
+    rootSources.erase(remove(rootSources.begin(), rootSources.end(), source), rootSources.end());
+}
+
+void Heap::markObject(Obj* object) {
+    if (object == nullptr || object->marked) return;
+    object->marked = true;
+    grayStack.push_back(object);
+}
+
+void Heap::collect() {
+    auto start = chrono::steady_clock::now();
+    size_t before = bytesAllocated;
+
+    markRoots();
+    traceReferences();
+    strings.removeUnmarked();
+    sweep();
+
+    nextGC = max(static_cast<size_t>(bytesAllocated * growthFactor), INITIAL_GC_THRESHOLD);
+
+    double pauseMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    stats.collections++;
+    stats.totalPauseMs += pauseMs;
+    stats.maxPauseMs = max(stats.maxPauseMs, pauseMs);
+    stats.bytesReclaimed += before - bytesAllocated;
+}
+
+void Heap::markRoots() {
+    for (const Value& value : tempRoots) {
+        markValue(value);
+    }
+    for (GcRootSource* source : rootSources) {
+        source->markRoots(*this);
+    }
+}
+
+void Heap::traceReferences() {
+    // Gray objects are marked but their references have not been visited yet
+    while (!grayStack.empty()) {
+        Obj* object = grayStack.back();
+        grayStack.pop_back();
+        object->trace(*this);
+    }
+}
+
+void Heap::sweep() {
+    Obj** link = &objects;
+    while (*link != nullptr) {
+        Obj* object = *link;
+        if (object->marked) {
+            object->marked = false;
+            link = &object->next;
+        } else {
+            *link = object->next;
+            bytesAllocated -= object->size;
+            stats.objectsFreed++;
+            delete object;
+        }
+    }
+}
+
+void Heap::printStats(ostream& out) const {
+    out << fixed << setprecision(3)
+        << "[gc] collections=" << stats.collections
+        << " pause_total_ms=" << stats.totalPauseMs
+        << " pause_max_ms=" << stats.maxPauseMs
+        << " bytes_allocated=" << stats.bytesAllocated
+        << " bytes_reclaimed=" << stats.bytesReclaimed
+        << " objects_allocated=" << stats.objectsAllocated
+        << " objects_freed=" << stats.objectsFreed
+        << " heap_bytes=" << bytesAllocated
+        << " peak_heap_bytes=" << stats.peakHeapBytes
+        << defaultfloat << endl;
+}
@@ -0,0 +1,158 @@
+#ifndef HEAP_H
+#define HEAP_H
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "Object.h"
+#include "StringTable.h"
+#include "Value.h"
+
+class Heap;
+
+// Anything outside the heap that holds references into it (the Interpreter,
+// the VM, the Compiler) registers itself so the collector can find its roots
+class GcRootSource {
+public:
+    virtual ~GcRootSource() = default;
+    virtual void markRoots(Heap& heap) = 0;
+};
+
+// Counters reported by --gc-stats
+struct HeapStats {
+    size_t collections = 0;
+    double totalPauseMs = 0;
+    double maxPauseMs = 0;
+    size_t bytesAllocated = 0;   // Total over the whole run
+    size_t bytesReclaimed = 0;
+    size_t objectsAllocated = 0;
+    size_t objectsFreed = 0;
+    size_t peakHeapBytes = 0;
+};
+
+// Owner of every Obj. Memory is reclaimed by a stop-the-world mark-and-sweep
+// collection whenever the bytes allocated since the last one pass a threshold;
+// after each collection the threshold is set to the surviving heap size times
+// the growth factor.
+class Heap {
+public:
+    static Heap& instance();
+
+    Heap() = default;
+    Heap(const Heap&) = delete;
+    Heap& operator=(const Heap&) = delete;
+    ~Heap();
+
+    template<typename T, typename... Args>
+    T* allocate(Args&&... args) {
+        if (bytesAllocated + sizeof(T) > nextGC || stressCollect()) {
+            collect();
+        }
+
+        T* object = new T(std::forward<Args>(args)...);
+        track(object, sizeof(T));
+        return object;
+    }
+
+    // Returns the one string object with these contents, creating it on
+    // first use. The table is weak, so unreachable strings are still freed.
+    ObjString* intern(std::string_view chars);
+    ObjString* intern(std::string&& chars);
+
+    // The interned string with these contents, or null. Never allocates.
+    ObjString* findString(std::string_view chars) const {
+        return strings.find(chars, ObjString::hashChars(chars));
+    }
+
+    // Counts memory an object took on after it was allocated. Never collects.
+    void charge(Obj* object, size_t bytes);
+
+    void collect();
+
+    void addRootSource(GcRootSource* source);
+    void removeRootSource(GcRootSource* source);
+
+    // Roots for Values that only live in C++ locals, see TempRoots
+    void pushTempRoot(const Value& value) { tempRoots.push_back(value); }
+    size_t tempRootCount() const { return tempRoots.size(); }
+    void popTempRoots(size_t count) { tempRoots.resize(count); }
+
+    void markValue(const Value& value) {
+        if (value.isObj()) markObject(value.asObj());
+    }
+    void markObject(Obj* object);
+
+    void setGrowthFactor(double factor) { growthFactor = factor; }
+    const HeapStats& getStats() const { return stats; }
+    void printStats(std::ostream& out) const;
+
+private:
+    static constexpr size_t INITIAL_GC_THRESHOLD = 1024 * 1024;
+
+    Obj* objects = nullptr;
+    size_t bytesAllocated = 0;
+    size_t nextGC = INITIAL_GC_THRESHOLD;
+    double growthFactor = 2.0;
+
+    std::vector<GcRootSource*> rootSources;
+    std::vector<Value> tempRoots;
+    std::vector<Obj*> grayStack;
+    StringTable strings;
+    HeapStats stats;
+
+    void track(Obj* object, size_t baseSize);
+    bool stressCollect() const;
+    void markRoots();
+    void traceReferences();
+    void sweep();
+};
+
+// Keeps Values held in C++ locals alive until the end of the enclosing scope.
+// Needed whenever such a Value must survive an evaluation that may allocate.
+class TempRoots {
+public:
+    explicit TempRoots(Heap& heap) : heap(heap), base(heap.tempRootCount()) {}
+    TempRoots(const TempRoots&) = delete;
+    TempRoots& operator=(const TempRoots&) = delete;
+    ~TempRoots() { heap.popTempRoots(base); }
+
+    void add(const Value& value) {
+        if (value.isObj()) heap.pushTempRoot(value);
+    }
+
+private:
+    Heap& heap;
+    size_t base;
+};
+
+// Keeps Values alive for as long as it exists, however many collections
+// happen in between. Holds the literals baked into a syntax tree, which
+// live outside the heap for the whole run.
+class PinnedValues : public GcRootSource {
+public:
+    explicit PinnedValues(Heap& heap) : heap(heap) { heap.addRootSource(this); }
+    PinnedValues(const PinnedValues&) = delete;
+    PinnedValues& operator=(const PinnedValues&) = delete;
+    ~PinnedValues() { heap.removeRootSource(this); }
+
+    // Returns the value, so a new object can be pinned where it is created
+    const Value& add(const Value& value) {
+        if (value.isObj()) values.push_back(value);
+        return value;
+    }
+
+    void markRoots(Heap& heap) override {
+        for (const Value& value : values) {
+            heap.markValue(value);
+        }
+    }
+
+private:
+    Heap& heap;
+    std::vector<Value> values;
+};
+
+#endif // HEAP_H
@@ -1,150 +1,354 @@
 #include "Interpreter.h"
 #include "LoxBuiltinFunctions.h"
 #include "LoxFunction.h"
-#include <iostream>
+#include "LoxClass.h"
+#include "LoxCollections.h"
+#include "Output.h"
+#include <algorithm>
+#include <sys/resource.h>
 
 using namespace std;
 
-Interpreter::Interpreter() {
-    globals = new Environment();
+Interpreter::Interpreter(size_t maxCallDepth)
+    : heap(Heap::instance()), maxCallDepth(min(maxCallDepth, nativeCallDepthLimit())) {
+    heap.addRootSource(this);
+    globals = heap.allocate<Environment>();
     environment = globals;
     
     // Define built-in functions
-    auto builtins = getBuiltinFunctions();
-    for (const auto& [name, function] : builtins) {
-        globals->define(name, Value(function));
-    }
+    defineBuiltinFunctions([this](string_view name, const Value& function) {
+        globals->define(name, function);
+    });
 }
 
 Interpreter::~Interpreter() {
-    delete environment;
+    heap.removeRootSource(this);
+}
+
+void Interpreter::markRoots(Heap& heap) {
+    heap.markObject(globals);
+    heap.markObject(environment);
+    for (Environment* suspended : suspendedEnvironments) {
+        heap.markObject(suspended);
+    }
+    for (Value* slot = stack.get(); slot < stackTop; slot++) {
+        heap.markValue(*slot);
+    }
+    heap.markValue(returnValue);
+    heap.markValue(tailCall.receiver);
 }
 
-void Interpreter::interpret(const vector<shared_ptr<Stmt>>& statements) {
+size_t Interpreter::nativeStackBudget() {
+    // An unlimited stack still runs into whatever is mapped below it
+    size_t size = 8 * 1024 * 1024;
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_STACK, &limit) == 0 && limit.rlim_cur != RLIM_INFINITY) {
+        size = limit.rlim_cur;
+    }
+    return size - min(NATIVE_STACK_MARGIN, size / 2);
+}
+
+size_t Interpreter::nativeCallDepthLimit() {
+    return nativeStackBudget() / NATIVE_BYTES_PER_CALL;
+}
+
+void Interpreter::interpret(const vector<Stmt*>& statements, int frameSize) {
+    // Measured from here; what the host used getting here comes out of the margin
+    char base;
+    nativeStackLimit = reinterpret_cast<uintptr_t>(&base) - nativeStackBudget();
+
+    size_t capacity = frameSize + maxCallDepth * SLOTS_PER_CALL;
+    stack.reset(static_cast<Value*>(::operator new(capacity * sizeof(Value))));
+    stackEnd = stack.get() + capacity;
+    frame = stack.get();
+    stackTop = frame + frameSize;
+    for (Value* slot = frame; slot < stackTop; slot++) {
+        *slot = Value();
+    }
+
     try {
         for (const auto& statement : statements) {
-            execute(statement.get());
+            // A top-level return ends the program
+            if (execute(statement) != ExecStatus::NORMAL) break;
         }
     } catch (RuntimeError& error) {
+        // Calls that were unwound leave their arguments behind
+        stackTop = stack.get();
+        frame = stack.get();
         Lox::runtimeError(error);
     }
 }
 
 // Statement visitor methods
-void Interpreter::visitExpression(Expression* stmt) {
-    evaluate(stmt->expression.get());
+ExecStatus Interpreter::visitExpression(Expression* stmt) {
+    evaluate(stmt->expression);
     // We discard the value since this is an expression statement
+    return ExecStatus::NORMAL;
 }
 
-void Interpreter::visitIf(If* stmt) {
-    if(evaluate(stmt->condition.get()).isTruthy()) {
-        execute(stmt->thenBranch.get());
+ExecStatus Interpreter::visitIf(If* stmt) {
+    if(evaluate(stmt->condition).isTruthy()) {
+        return execute(stmt->thenBranch);
     } else if(stmt->elseBranch != nullptr) {
-        execute(stmt->elseBranch.get());
+        return execute(stmt->elseBranch);
+    }
+    return ExecStatus::NORMAL;
+}
+
+ExecStatus Interpreter::visitWhile(While* stmt) {
+    while(evaluate(stmt->condition).isTruthy()) {
+        ExecStatus status = execute(stmt->body);
+        if (status != ExecStatus::NORMAL) return status;
     }
+    return ExecStatus::NORMAL;
 }
 
-void Interpreter::visitWhile(While* stmt) {
-    while(evaluate(stmt->condition.get()).isTruthy()) {
-        execute(stmt->body.get());
+ExecStatus Interpreter::visitForEach(ForEach* stmt) {
+    Value sequence = evaluate(stmt->iterable);
+    TempRoots roots(heap);
+    roots.add(sequence);
+    LoxList* list = iterationList(sequence);
+    if (list == nullptr) {
+        throw RuntimeError(stmt->name, "Can only iterate over lists and maps.");
+    }
+    roots.add(Value(list));
+
+    // The length is checked on every pass since the body may change the list
+    if (stmt->inFrame) {
+        // Nothing captures the loop variable, so one slot serves every pass
+        for (size_t i = 0; i < list->elements.size(); i++) {
+            frame[stmt->slot] = list->elements[i];
+            ExecStatus status = execute(stmt->body);
+            if (status != ExecStatus::NORMAL) return status;
+        }
+        return ExecStatus::NORMAL;
+    }
+
+    const vector<Stmt*> body{stmt->body};
+    for (size_t i = 0; i < list->elements.size(); i++) {
+        Environment* loopEnvironment = heap.allocate<Environment>(environment, 1);
+        loopEnvironment->defineAt(0, list->elements[i]);
+        ExecStatus status = executeBlock(body, loopEnvironment);
+        if (status != ExecStatus::NORMAL) return status;
     }
+    return ExecStatus::NORMAL;
 }
 
-void Interpreter::visitPrint(Print* stmt) {
-    Value value = evaluate(stmt->expression.get());
-    cout << value.toString() << endl;
+ExecStatus Interpreter::visitPrint(Print* stmt) {
+    Output::print(evaluate(stmt->expression));
+    return ExecStatus::NORMAL;
 }
 
-void Interpreter::visitVar(Var* stmt) {
+ExecStatus Interpreter::visitVar(Var* stmt) {
     Value value;  // Default constructor creates a nil value
     if(stmt->initializer != nullptr) {
-        value = evaluate(stmt->initializer.get());
+        value = evaluate(stmt->initializer);
     }
 
-    environment->define(stmt->name.lexeme, value);
+    if (stmt->inFrame) {
+        frame[stmt->slot] = value;
+    } else if (stmt->slot >= 0) {
+        environment->defineAt(stmt->slot, value);
+    } else {
+        globals->define(stmt->name.lexeme, value);
+    }
+    return ExecStatus::NORMAL;
 }
 
-void Interpreter::visitBlock(Block* stmt) {
-    executeBlock(stmt->statements, new Environment(*environment));
+ExecStatus Interpreter::visitBlock(Block* stmt) {
+    if (stmt->slotCount == 0) {
+        // Any locals the block has already have slots in the frame
+        for (Stmt* statement : stmt->statements) {
+            ExecStatus status = execute(statement);
+            if (status != ExecStatus::NORMAL) return status;
+        }
+        return ExecStatus::NORMAL;
+    }
+    return executeBlock(stmt->statements, heap.allocate<Environment>(environment, stmt->slotCount));
 }
 
-void Interpreter::visitFunction(Function* stmt) {
-    // Create a function object and define it in the current environment
-    auto function = make_shared<LoxFunction>(stmt, environment);
-    Value functionValue;
-    functionValue = Value(std::static_pointer_cast<LoxCallable>(function));
-    environment->define(stmt->name.lexeme, functionValue);
+ExecStatus Interpreter::visitClass(Class* stmt) {
+    LoxClass* superclass = nullptr;
+    if (stmt->superclass != nullptr) {
+        Value value = evaluate(stmt->superclass);
+        if (!value.isClass()) {
+            throw RuntimeError(stmt->superclass->name, "Superclass must be a class.");
+        }
+        superclass = value.getClass();
+    }
+
+    LoxClass* klass = heap.allocate<LoxClass>(string(stmt->name.lexeme));
+    TempRoots roots(heap);
+    roots.add(Value(klass));
+
+    // Methods of a subclass close over an environment holding "super",
+    // matching the scope the Resolver put around them
+    Environment* methodClosure = environment;
+    if (superclass != nullptr) {
+        klass->inherit(superclass);
+        methodClosure = heap.allocate<Environment>(environment, 1);
+        methodClosure->defineAt(0, Value(superclass));
+        roots.add(Value(methodClosure));
+    }
+
+    for (Function* method : stmt->methods) {
+        ObjString* name = heap.intern(method->name.lexeme);
+        roots.add(Value(name));
+        klass->addMethod(name, heap.allocate<LoxFunction>(method, methodClosure));
+    }
+
+    if (stmt->inFrame) {
+        frame[stmt->slot] = Value(klass);
+    } else if (stmt->slot >= 0) {
+        environment->defineAt(stmt->slot, Value(klass));
+    } else {
+        globals->define(stmt->name.lexeme, Value(klass));
+    }
+    return ExecStatus::NORMAL;
 }
 
-void Interpreter::visitReturn(Return* stmt) {
+ExecStatus Interpreter::visitFunction(Function* stmt) {
+    // Create a function object closing over the current environment
+    Value functionValue(heap.allocate<LoxFunction>(stmt, environment));
+    if (stmt->inFrame) {
+        frame[stmt->slot] = functionValue;
+    } else if (stmt->slot >= 0) {
+        environment->defineAt(stmt->slot, functionValue);
+    } else {
+        globals->define(stmt->name.lexeme, functionValue);
+    }
+    return ExecStatus::NORMAL;
+}
+
+ExecStatus Interpreter::visitReturn(Return* stmt) {
+    if (stmt->tailCall != nullptr) {
+        return returnCall(stmt->tailCall);
+    }
+
     Value value; // Default to nil
     
     // Evaluate the return value if provided
     if (stmt->value != nullptr) {
-        value = evaluate(stmt->value.get());
+        value = evaluate(stmt->value);
     }
     
-    // Throw a ReturnException to unwind the call stack
-    throw ReturnException(value);
-}
-
-// Add the implementation for the resolve method
-void Interpreter::resolve(Expr* expr, int depth) {
-    locals[static_cast<void*>(expr)] = depth;
+    // Hand the value to the enclosing call and unwind up to it
+    returnValue = std::move(value);
+    return ExecStatus::RETURN;
 }
 
 // Helper method for executing statements
-void Interpreter::execute(Stmt* stmt) {
-    stmt->accept(*this);
+ExecStatus Interpreter::execute(Stmt* stmt) {
+    return stmt->accept(*this);
 }
 
-void Interpreter::executeBlock(const std::vector<std::shared_ptr<Stmt>>& statements, Environment* newEnvironment) {
-    Environment* previous = environment;
+ExecStatus Interpreter::executeBlock(const std::vector<Stmt*>& statements, Environment* newEnvironment) {
+    // The caller's environment is kept where the collector can see it; the
+    // block's environment lives on after we leave if a closure captured it
+    suspendedEnvironments.push_back(environment);
+    ExecStatus status = ExecStatus::NORMAL;
     try {
         environment = newEnvironment;
 
         for(const auto& statement : statements) {
-            execute(statement.get());
+            status = execute(statement);
+            if (status != ExecStatus::NORMAL) break;
         }
     } catch (...) {
-        environment = previous;
-        delete newEnvironment;
+        environment = suspendedEnvironments.back();
+        suspendedEnvironments.pop_back();
         throw;
     }
     
-    environment = previous;
-    delete newEnvironment;
+    environment = suspendedEnvironments.back();
+    suspendedEnvironments.pop_back();
+    return status;
 }
 
-// New helper method for looking up variables
-Value Interpreter::lookUpVariable(const Token& name, Expr* expr) {
-    for (const auto& [key, distance] : locals) {
-        if (key == static_cast<void*>(expr)) {
-            return environment->getAt(distance, name.lexeme);
+ExecStatus Interpreter::executeCall(LoxFunction* function, const Value& receiver, Value* arguments) {
+    Value* callerFrame = frame;
+    Value* callerTop = stackTop;
+    size_t callerDepth = calls.size();
+    int line = callLine;
+    Value self = receiver;
+    ExecStatus status;
+    try {
+        for (;;) {
+            const Function& declaration = *function->getDeclaration();
+            size_t arity = declaration.params.size();
+            Value* frameEnd = arguments + declaration.frameSize;
+            // A call in tail position replaces the running one, so only
+            // runs out of room if its frame is bigger
+            if (calls.size() == maxCallDepth || frameEnd > stackEnd || nativeStackExhausted()) {
+                throw stackOverflow(line);
+            }
+            calls.push_back(ActiveCall{&declaration, line});
+            // Slots past the arguments may hold stale values from earlier
+            // calls, which the collector must not see
+            for (Value* slot = arguments + arity; slot < frameEnd; slot++) {
+                *slot = Value();
+            }
+            if (declaration.isMethod) {
+                arguments[arity] = self;
+            }
+            frame = arguments;
+            stackTop = frameEnd;
+
+            // Only a function with captured locals needs an environment of
+            // its own; variables from outside are found through the closure
+            Environment* callEnvironment = function->getClosure();
+            if (declaration.slotCount > 0) {
+                callEnvironment = heap.allocate<Environment>(callEnvironment, declaration.slotCount);
+                for (size_t i = 0; i < declaration.capturedParams.size(); i++) {
+                    callEnvironment->defineAt(i, frame[declaration.capturedParams[i]]);
+                }
+            }
+            status = executeBlock(declaration.body, callEnvironment);
+            calls.pop_back();
+            if (status != ExecStatus::TAIL_CALL) break;
+
+            // The call in tail position replaces this one: its callee and
+            // arguments move down into this frame's slots
+            function = tailCall.function;
+            self = tailCall.receiver;
+            tailCall.receiver = Value();
+            arguments[-1] = Value(function);
+            std::copy(tailCall.arguments, tailCall.arguments + function->arity(), arguments);
         }
+    } catch (...) {
+        frame = callerFrame;
+        stackTop = callerTop;
+        calls.resize(callerDepth);
+        throw;
+    }
+    frame = callerFrame;
+    stackTop = callerTop;
+    return status;
+}
+
+// Locals go straight to the frame slot or environment the Resolver found them in
+Value Interpreter::lookUpVariable(const Token& name, int depth, int slot, bool inFrame) {
+    if (inFrame) {
+        return frame[slot];
+    }
+    if (depth >= 0) {
+        return environment->getAt(depth, slot);
     }
     return globals->get(name);
 }
 
-// Update visitVariable to use the lookUpVariable helper
 Value Interpreter::visitVariable(Variable* expr) {
-    return lookUpVariable(expr->name, expr);
+    return lookUpVariable(expr->name, expr->depth, expr->slot, expr->inFrame);
 }
 
-// Update visitAssign to use the lookUpVariable helper for resolved variables
 Value Interpreter::visitAssign(Assign* expr) {
-    Value value = evaluate(expr->value.get());
-
-    bool found = false;
-    for (const auto& [key, distance] : locals) {
-        if (key == static_cast<void*>(expr)) {
-            environment->assignAt(distance, expr->name, value);
-            found = true;
-            break;
-        }
-    }
-    
-    if (!found) {
+    Value value = evaluate(expr->value);
+
+    if (expr->inFrame) {
+        frame[expr->slot] = value;
+    } else if (expr->depth >= 0) {
+        environment->assignAt(expr->depth, expr->slot, value);
+    } else {
         globals->assign(expr->name, value);
     }
 
@@ -153,11 +357,11 @@ Value Interpreter::visitAssign(Assign* expr) {
 
 // Expression visitor methods
 Value Interpreter::visitLiteralExpr(LiteralExpr* expr) {
-    return literalToValue(expr->value);
+    return expr->value;
 }
 
 Value Interpreter::visitLogical(Logical* expr) {
-    Value left = evaluate(expr->left.get());
+    Value left = evaluate(expr->left);
 
     if(expr->op.type == OR) {
         if(left.isTruthy())
@@ -167,15 +371,15 @@ Value Interpreter::visitLogical(Logical* expr) {
             return left;
     }
     
-    return evaluate(expr->right.get());
+    return evaluate(expr->right);
 }
 
 Value Interpreter::visitGrouping(Grouping* expr) {
-    return evaluate(expr->expression.get());
+    return evaluate(expr->expression);
 }
 
 Value Interpreter::visitUnary(Unary* expr) {
-    Value right = evaluate(expr->right.get());
+    Value right = evaluate(expr->right);
     
     switch (expr->op.type) {
         case MINUS:
@@ -189,10 +393,53 @@ Value Interpreter::visitUnary(Unary* expr) {
     }
 }
 
+// The number form an operator quickens to, or GENERIC if it has none
+static Binary::Form numberForm(TokenType op) {
+    switch (op) {
+        case PLUS:          return Binary::Form::NUMBER_ADD;
+        case MINUS:         return Binary::Form::NUMBER_SUBTRACT;
+        case STAR:          return Binary::Form::NUMBER_MULTIPLY;
+        case SLASH:         return Binary::Form::NUMBER_DIVIDE;
+        case GREATER:       return Binary::Form::NUMBER_GREATER;
+        case GREATER_EQUAL: return Binary::Form::NUMBER_GREATER_EQUAL;
+        case LESS:          return Binary::Form::NUMBER_LESS;
+        case LESS_EQUAL:    return Binary::Form::NUMBER_LESS_EQUAL;
+        default:            return Binary::Form::GENERIC;  // Equality has no type checks to skip
+    }
+}
+
 Value Interpreter::visitBinary(Binary* expr) {
-    Value left = evaluate(expr->left.get());
-    Value right = evaluate(expr->right.get());
-    
+    Value left = evaluate(expr->left);
+    // Evaluating the right operand may allocate
+    TempRoots roots(heap);
+    roots.add(left);
+    Value right = evaluate(expr->right);
+
+    if (expr->form != Binary::Form::GENERIC) {
+        if (left.isNumber() && right.isNumber()) {
+            if (expr->form == Binary::Form::UNQUICKENED) expr->form = numberForm(expr->op.type);
+            double a = left.asNumber();
+            double b = right.asNumber();
+            switch (expr->form) {
+                case Binary::Form::NUMBER_ADD:           return Value(a + b);
+                case Binary::Form::NUMBER_SUBTRACT:      return Value(a - b);
+                case Binary::Form::NUMBER_MULTIPLY:      return Value(a * b);
+                case Binary::Form::NUMBER_DIVIDE:
+                    if (b == 0) throw RuntimeError(expr->op, "Division by zero.");
+                    return Value(a / b);
+                case Binary::Form::NUMBER_GREATER:       return Value(a > b);
+                case Binary::Form::NUMBER_GREATER_EQUAL: return Value(a >= b);
+                case Binary::Form::NUMBER_LESS:          return Value(a < b);
+                case Binary::Form::NUMBER_LESS_EQUAL:    return Value(a <= b);
+                default:
+                    break;
+            }
+        } else {
+            // Deoptimize: the operands aren't always numbers
+            expr->form = Binary::Form::GENERIC;
+        }
+    }
+
     switch (expr->op.type) {
         // Arithmetic operations
         case MINUS:
@@ -212,7 +459,8 @@ Value Interpreter::visitBinary(Binary* expr) {
                 return Value(left.getNumber() + right.getNumber());
             }
             if (left.isString() && right.isString()) {
-                return Value(left.getString() + right.getString());
+                roots.add(right);
+                return Value::concatenate(left, right);
             }
             throw RuntimeError(expr->op, "Operands must be two numbers or two strings.");
             
@@ -242,30 +490,267 @@ Value Interpreter::visitBinary(Binary* expr) {
 }
 
 Value Interpreter::visitCall(Call* expr) {
-    Value callee = evaluate(expr->callee.get());
+    // The receiver must survive evaluating the arguments and allocating the
+    // call's environment
+    TempRoots roots(heap);
+    Value receiver;
+    bool isMethod = false;
+    Value* arguments = pushCall(expr, receiver, isMethod, roots);
+
+    Value result = callValue(arguments[-1], isMethod ? &receiver : nullptr, arguments, expr->arguments.size(), expr->paren);
+    stackTop = arguments - 1;
+    return result;
+}
+
+Value* Interpreter::pushCall(Call* expr, Value& receiver, bool& isMethod, TempRoots& roots) {
+    Value callee;
+    if (expr->methodCallee != nullptr) {
+        receiver = evaluate(expr->methodCallee->object);
+        roots.add(receiver);
+        callee = getProperty(expr->methodCallee, receiver, isMethod);
+    } else if (expr->superCallee != nullptr) {
+        Super* super = expr->superCallee;
+        receiver = super->thisInFrame ? frame[super->thisSlot] : environment->getAt(super->thisDepth, super->thisSlot);
+        callee = getSuperMethod(expr->superCallee);
+        isMethod = true;
+    } else {
+        callee = evaluate(expr->callee);
+    }
+
+    // The callee and arguments go straight onto the value stack, which
+    // keeps them reachable and where the arguments become the start of the
+    // callee's frame
+    if (stackTop + 1 + expr->arguments.size() > stackEnd) {
+        throw stackOverflow(expr->paren.line);
+    }
+    *stackTop++ = callee;
+    Value* arguments = stackTop;
+    for (Expr* argument : expr->arguments) {
+        Value value = evaluate(argument);
+        *stackTop++ = value;
+    }
+    return arguments;
+}
+
+ExecStatus Interpreter::returnCall(Call* expr) {
+    TempRoots roots(heap);
+    Value receiver;
+    bool isMethod = false;
+    Value* arguments = pushCall(expr, receiver, isMethod, roots);
+    const Value& callee = arguments[-1];
+    int argCount = expr->arguments.size();
+
+    LoxFunction* function = nullptr;
+    if (isMethod) {
+        function = static_cast<LoxFunction*>(callee.getCallable());
+    } else if (callee.isBoundMethod()) {
+        LoxBoundMethod* bound = callee.getBoundMethod();
+        function = static_cast<LoxFunction*>(bound->method);
+        receiver = bound->receiver;
+        isMethod = true;
+    } else if (callee.isCallable()) {
+        function = callee.getCallable()->asFunction();
+    }
+
+    // Initializers return their receiver rather than what their body returns
+    if (function != nullptr && !function->getDeclaration()->isInitializer()) {
+        checkArity(function, argCount, expr->paren);
+        tailCall = TailCall{function, isMethod ? receiver : Value(), arguments};
+        return ExecStatus::TAIL_CALL;
+    }
 
-    vector<Value> arguments;
-    for(const auto& argument : expr->arguments) {
-        arguments.push_back(evaluate(argument.get()));
+    returnValue = callValue(callee, isMethod ? &receiver : nullptr, arguments, argCount, expr->paren);
+    stackTop = arguments - 1;
+    return ExecStatus::RETURN;
+}
+
+Value Interpreter::callValue(const Value& callee, const Value* receiver, Value* arguments, int argCount, const Token& paren) {
+    callLine = paren.line;
+    if (receiver != nullptr) {
+        LoxFunction* method = static_cast<LoxFunction*>(callee.getCallable());
+        checkArity(method, argCount, paren);
+        return method->invoke(this, *receiver, arguments);
+    }
+
+    if (callee.isBoundMethod()) {
+        // The bound method is only kept alive by the callee slot, which a
+        // call in tail position takes over
+        LoxBoundMethod* bound = callee.getBoundMethod();
+        Value receiver = bound->receiver;
+        TempRoots roots(heap);
+        roots.add(receiver);
+        return callValue(Value(bound->method), &receiver, arguments, argCount, paren);
+    }
+
+    if (callee.isClass()) {
+        LoxClass* klass = callee.getClass();
+        Value instance(heap.allocate<LoxInstance>(klass->instanceShape()));
+        TempRoots roots(heap);
+        roots.add(instance);
+
+        if (klass->initializer != nullptr) {
+            return callValue(Value(klass->initializer), &instance, arguments, argCount, paren);
+        }
+        if (argCount != 0) {
+            throw RuntimeError(paren, "Expected 0 arguments but got " + std::to_string(argCount) + ".");
+        }
+        return instance;
     }
 
     if (!callee.isCallable()) {
-        throw RuntimeError(expr->paren, "Can only call functions and classes.");
+        throw RuntimeError(paren, "Can only call functions and classes.");
     }
 
-    shared_ptr<LoxCallable> function = callee.getCallable();
-    
-    // Check argument count
-    if (arguments.size() != function->arity()) {
-        throw RuntimeError(expr->paren, 
+    LoxCallable* function = callee.getCallable();
+    checkArity(function, argCount, paren);
+    try {
+        return function->call(this, arguments);
+    } catch (NativeError& error) {
+        throw RuntimeError(paren, error.what());
+    }
+}
+
+void Interpreter::checkArity(LoxCallable* function, size_t argumentCount, const Token& paren) {
+    if (argumentCount != static_cast<size_t>(function->arity())) {
+        throw RuntimeError(paren, 
             "Expected " + std::to_string(function->arity()) + 
-            " arguments but got " + std::to_string(arguments.size()) + ".");
+            " arguments but got " + std::to_string(argumentCount) + ".");
     }
-    
-    return function->call(this, arguments);
+}
+
+RuntimeError Interpreter::stackOverflow(int line) const {
+    // Each call is running the line it made the next call on
+    RuntimeError error(line, "Stack overflow.");
+    for (size_t i = calls.size(); i > 0; i--) {
+        error.addTraceFrame(line, std::string(calls[i - 1].declaration->name.lexeme));
+        line = calls[i - 1].line;
+    }
+    error.addTraceFrame(line, "");
+    return error;
+}
+
+Value Interpreter::getProperty(Get* expr, const Value& object, bool& isMethod) {
+    if (!object.isInstance()) {
+        throw RuntimeError(expr->name, "Only instances have properties.");
+    }
+
+    Value result;
+    switch (object.getInstance()->getProperty(expr->name.lexeme, expr->cache, result)) {
+        case PropertyKind::FIELD:
+            isMethod = false;
+            return result;
+        case PropertyKind::METHOD:
+            isMethod = true;
+            return result;
+        default:
+            throw RuntimeError(expr->name, "Undefined property '" + string(expr->name.lexeme) + "'.");
+    }
+}
+
+Value Interpreter::getSuperMethod(Super* expr) {
+    LoxClass* superclass = environment->getAt(expr->depth, expr->slot).getClass();
+
+    // Method names are interned when their class is declared
+    ObjString* name = heap.findString(expr->method.lexeme);
+    Obj* method = name != nullptr ? superclass->findMethod(name) : nullptr;
+    if (method == nullptr) {
+        throw RuntimeError(expr->method, "Undefined property '" + string(expr->method.lexeme) + "'.");
+    }
+    return Value(method);
+}
+
+Value Interpreter::visitGet(Get* expr) {
+    Value object = evaluate(expr->object);
+    bool isMethod;
+    Value property = getProperty(expr, object, isMethod);
+    if (!isMethod) return property;
+
+    TempRoots roots(heap);
+    roots.add(object);
+    return Value(heap.allocate<LoxBoundMethod>(object, property.asObj()));
+}
+
+Value Interpreter::visitSet(Set* expr) {
+    Value object = evaluate(expr->object);
+    if (!object.isInstance()) {
+        throw RuntimeError(expr->name, "Only instances have fields.");
+    }
+
+    TempRoots roots(heap);
+    roots.add(object);
+    Value value = evaluate(expr->value);
+    roots.add(value);
+    object.getInstance()->setProperty(expr->name.lexeme, value, expr->cache);
+    return value;
+}
+
+Value Interpreter::visitIndex(Index* expr) {
+    Value object = evaluate(expr->object);
+    TempRoots roots(heap);
+    roots.add(object);
+    Value index = evaluate(expr->index);
+
+    Value result;
+    if (const char* message = getIndex(object, index, result)) {
+        throw RuntimeError(expr->bracket, message);
+    }
+    return result;
+}
+
+Value Interpreter::visitIndexSet(IndexSet* expr) {
+    Value object = evaluate(expr->object);
+    TempRoots roots(heap);
+    roots.add(object);
+    Value index = evaluate(expr->index);
+    roots.add(index);
+    Value value = evaluate(expr->value);
+
+    if (const char* message = setIndex(object, index, value)) {
+        throw RuntimeError(expr->bracket, message);
+    }
+    return value;
+}
+
+Value Interpreter::visitListLiteral(ListLiteral* expr) {
+    // The list is rooted while its elements are evaluated
+    LoxList* list = heap.allocate<LoxList>();
+    TempRoots roots(heap);
+    roots.add(Value(list));
+    for (Expr* element : expr->elements) {
+        list->push(evaluate(element));
+    }
+    return Value(list);
+}
+
+Value Interpreter::visitMapLiteral(MapLiteral* expr) {
+    LoxMap* map = heap.allocate<LoxMap>();
+    TempRoots roots(heap);
+    roots.add(Value(map));
+    for (size_t i = 0; i < expr->keys.size(); i++) {
+        Value key = evaluate(expr->keys[i]);
+        roots.add(key);
+        map->set(key, evaluate(expr->values[i]));
+    }
+    return Value(map);
+}
+
+Value Interpreter::visitSuper(Super* expr) {
+    // The superclass lives in the environment chain; the receiver may be in
+    // the method's frame
+    Value receiver = expr->thisInFrame ? frame[expr->thisSlot] : environment->getAt(expr->thisDepth, expr->thisSlot);
+    Value method = getSuperMethod(expr);
+    return Value(heap.allocate<LoxBoundMethod>(receiver, method.asObj()));
+}
+
+Value Interpreter::visitThis(This* expr) {
+    return lookUpVariable(expr->keyword, expr->depth, expr->slot, expr->inFrame);
 }
 
 Value Interpreter::evaluate(Expr* expr) {
+    // Expressions don't know their line; the last call made is the best guess
+    if (nativeStackExhausted()) {
+        throw stackOverflow(callLine);
+    }
     return expr->accept(*this);
 }
 
@@ -278,13 +763,3 @@ void Interpreter::checkNumberOperands(const Token& op, const Value& left, const
     if (left.isNumber() && right.isNumber()) return;
     throw RuntimeError(op, "Operands must be numbers.");
 }
-
-Value Interpreter::literalToValue(const Literal& literal) {
-    if (literal.isNull()) return Value();
-    if (literal.isNumber()) return Value(literal.getNumber());
-    if (literal.isString()) return Value(literal.getString());
-    if (literal.isBoolean()) return Value(literal.getBoolean());
-    
-    // Should never happen
-    return Value();
-} 
\ No newline at end of file
@@ -1,6 +1,7 @@
 #ifndef INTERPRETER_H
 #define INTERPRETER_H
 
+#include <memory>
 #include <stdexcept>
 #include "Token.h"
 #include "Expr.h"
@@ -9,85 +10,200 @@
 #include "Lox.h"
 #include "Environment.h"
 #include "LoxCallable.h"
-#include "ReturnException.h"
+#include "Heap.h"
 #include <vector>
-#include <unordered_map>
+
+// A Lox call that was running when an error was raised. An empty function
+// name stands for the top-level script.
+struct TraceFrame {
+    int line;
+    std::string function;
+};
 
 // Custom exception for Interpreter runtime errors
 class RuntimeError : public std::runtime_error {
 private:
     Token token;
+    std::vector<TraceFrame> callTrace;
     
 public:
     RuntimeError(const std::string& message) 
-        : std::runtime_error(message), token(TokenType::EOF_TOKEN, "", Literal(), 0) {}
+        : std::runtime_error(message), token(TokenType::EOF_TOKEN, "", Value(), 0) {}
     
     RuntimeError(const Token& token, const std::string& message)
         : std::runtime_error(message), token(token) {}
+
+    // Used by the VM, which only knows the line an instruction came from
+    RuntimeError(int line, const std::string& message)
+        : std::runtime_error(message), token(TokenType::EOF_TOKEN, "", Value(), line) {}
         
     const Token& getToken() const { return token; }
+
+    // The calls the error unwinds, innermost first. Only errors where the
+    // line alone says too little, like a stack overflow, carry one.
+    const std::vector<TraceFrame>& getCallTrace() const { return callTrace; }
+    void addTraceFrame(int line, std::string function) {
+        callTrace.push_back(TraceFrame{line, std::move(function)});
+    }
 };
 
 // Multiple inheritance to implement both visitor interfaces
-class Interpreter : public ExprVisitor<Value>, public StmtVisitor<void> {
+class Interpreter : public ExprVisitor<Value>, public StmtVisitor<ExecStatus>, public GcRootSource {
 public:
-    // Constructor and destructor
-    Interpreter();
+    // Constructor and destructor. Lox calls may nest maxCallDepth deep
+    // before raising a stack overflow, or less if the native stack runs low
+    // first.
+    explicit Interpreter(size_t maxCallDepth);
     ~Interpreter();
 
+    // The deepest plain recursion the native stack has room for, and so the
+    // most a call-depth limit is allowed to be
+    static size_t nativeCallDepthLimit();
+
     // Getter for globals
     Environment* getGlobals() { return globals; }
 
-    // Main interpret method
-    void interpret(const std::vector<std::shared_ptr<Stmt>>& statements);
+    // Main interpret method. Locals of top-level blocks that no closure
+    // captures live in a frame of frameSize slots.
+    void interpret(const std::vector<Stmt*>& statements, int frameSize);
     
     // Method for executing blocks (needed by LoxFunction)
-    void executeBlock(const std::vector<std::shared_ptr<Stmt>>& statements, Environment* environment);
-    
-    // Method for resolver to tell the interpreter where a variable is resolved
-    void resolve(Expr* expr, int depth);
+    ExecStatus executeBlock(const std::vector<Stmt*>& statements, Environment* environment);
+
+    // Runs the body of a call to a Lox function. The arguments are on the
+    // value stack, where they become the first slots of the call's frame,
+    // and the slot before them holds the function. Calls the body makes in
+    // tail position run in the same frame before this returns.
+    ExecStatus executeCall(LoxFunction* function, const Value& receiver, Value* arguments);
+
+    // Value of the last return statement, collected by LoxFunction after a RETURN completion
+    Value takeReturnValue() { return std::move(returnValue); }
     
     // Expression visitor implementation
     Value visitAssign(Assign* expr) override;
     Value visitBinary(Binary* expr) override;
     Value visitCall(Call* expr) override;
+    Value visitGet(Get* expr) override;
     Value visitGrouping(Grouping* expr) override;
+    Value visitIndex(Index* expr) override;
+    Value visitIndexSet(IndexSet* expr) override;
+    Value visitListLiteral(ListLiteral* expr) override;
     Value visitLiteralExpr(LiteralExpr* expr) override;
     Value visitLogical(Logical* expr) override;
+    Value visitMapLiteral(MapLiteral* expr) override;
+    Value visitSet(Set* expr) override;
+    Value visitSuper(Super* expr) override;
+    Value visitThis(This* expr) override;
     Value visitUnary(Unary* expr) override;
     Value visitVariable(Variable* expr) override;
 
     // Statement visitor implementation
-    void visitBlock(Block* stmt) override;
-    void visitExpression(Expression* stmt) override;
-    void visitFunction(Function* stmt) override;
-    void visitIf(If* stmt) override;
-    void visitPrint(Print* stmt) override;
-    void visitReturn(Return* stmt) override;
-    void visitVar(Var* stmt) override;
-    void visitWhile(While* stmt) override;
+    ExecStatus visitBlock(Block* stmt) override;
+    ExecStatus visitClass(Class* stmt) override;
+    ExecStatus visitExpression(Expression* stmt) override;
+    ExecStatus visitForEach(ForEach* stmt) override;
+    ExecStatus visitFunction(Function* stmt) override;
+    ExecStatus visitIf(If* stmt) override;
+    ExecStatus visitPrint(Print* stmt) override;
+    ExecStatus visitReturn(Return* stmt) override;
+    ExecStatus visitVar(Var* stmt) override;
+    ExecStatus visitWhile(While* stmt) override;
+
+    // Globals, every environment still in use, the value stack and the
+    // pending return value
+    void markRoots(Heap& heap) override;
 
 private:
-    Environment* globals;
-    Environment* environment;
-    // Map for storing resolved variables
-    std::unordered_map<void*, int> locals;
+    Heap& heap;
+    Environment* globals = nullptr;
+    Environment* environment = nullptr;
+    // Environments of the blocks and calls we are nested in
+    std::vector<Environment*> suspendedEnvironments;
+    Value returnValue;
+
+    // Call arguments, and the frames of calls whose locals live outside
+    // environments. Frames are pushed and popped by moving stackTop.
+    // Calls all the way down the native stack hold pointers into it, so it
+    // can't grow; interpret() sizes it from the call-depth limit instead
+    // and leaves it uninitialized, so only the part a program reaches is
+    // ever touched.
+    static constexpr size_t SLOTS_PER_CALL = 256;
+    struct StackDeleter {
+        void operator()(Value* slots) const { ::operator delete(slots); }
+    };
+    std::unique_ptr<Value, StackDeleter> stack;
+    Value* stackEnd = nullptr;
+    Value* stackTop = nullptr;
+    Value* frame = nullptr;  // First slot of the running call's frame
+
+    // Set up by a return statement for executeCall to run in its frame
+    struct TailCall {
+        LoxFunction* function;
+        Value receiver;     // Nil unless the function is called as a method
+        Value* arguments;   // On the stack above the returning call's frame
+    };
+    TailCall tailCall;
+
+    // The Lox calls being run, outermost first, so running out of room can
+    // be reported with a trace instead of overflowing the native stack
+    struct ActiveCall {
+        const Function* declaration;
+        int line;  // Where the caller made the call
+    };
+    std::vector<ActiveCall> calls;
+    size_t maxCallDepth;
+    int callLine = 0;  // Line of the call callValue is making, for executeCall
+
+    // Every Lox call and every nested expression recurses on the native
+    // stack, and how much a call uses depends on how deeply its expressions
+    // nest, so counting calls alone can't stop it running out. Below this
+    // address, which interpret() sets from the stack's size limit, a stack
+    // overflow is raised instead. Stacks grow down on every platform we
+    // build for.
+    static constexpr size_t NATIVE_STACK_MARGIN = 256 * 1024;  // Kept for unwinding and natives
+    static constexpr size_t NATIVE_BYTES_PER_CALL = 1536;      // What a plain recursive call uses
+    uintptr_t nativeStackLimit = 0;
+    // How much of the native stack the program may use
+    static size_t nativeStackBudget();
+    bool nativeStackExhausted() const {
+        char here;
+        return reinterpret_cast<uintptr_t>(&here) < nativeStackLimit;
+    }
     
     // Helper methods for evaluating expressions
     Value evaluate(Expr* expr);
     
     // Helper method for executing statements
-    void execute(Stmt* stmt);
+    ExecStatus execute(Stmt* stmt);
     
-    // Helper for looking up variable in resolved environment
-    Value lookUpVariable(const Token& name, Expr* expr);
+    // Helper for looking up variable using the depth and slot stored by the Resolver
+    Value lookUpVariable(const Token& name, int depth, int slot, bool inFrame);
+
+    // Evaluates a call's callee and then its arguments onto the value stack,
+    // returning where the arguments start. A method read straight off an
+    // instance is pushed unbound, with its receiver put in receiver and roots.
+    Value* pushCall(Call* expr, Value& receiver, bool& isMethod, TempRoots& roots);
+
+    // Calls a function, class or bound method with the arguments on top of
+    // the value stack. A method read straight off an instance for a call is
+    // passed with its receiver instead of bound.
+    Value callValue(const Value& callee, const Value* receiver, Value* arguments, int argCount, const Token& paren);
+
+    // Runs return f(...): a Lox function is left for executeCall to run in
+    // place of the returning call, anything else is called as usual
+    ExecStatus returnCall(Call* expr);
+    void checkArity(LoxCallable* function, size_t argumentCount, const Token& paren);
+
+    // The error for a call made on line that there is no room for
+    RuntimeError stackOverflow(int line) const;
+
+    // Property lookups shared by gets and method calls; methods come back unbound
+    Value getProperty(Get* expr, const Value& object, bool& isMethod);
+    Value getSuperMethod(Super* expr);
     
     // Helper for checking number operands
     void checkNumberOperand(const Token& op, const Value& operand);
     void checkNumberOperands(const Token& op, const Value& left, const Value& right);
-    
-    // Converting Literal to Value
-    Value literalToValue(const Literal& literal);
 };
 
 #endif // INTERPRETER_H 
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include "Lox.h"
 #include <iostream>
 #include <fstream>
+#include <algorithm>
 #include <memory> 
 #include "Scanner.h"
 #include "Parser.h"
@@ -10,52 +11,85 @@
 #include "AstPrinter.h"
 #include "Interpreter.h"
 #include "Resolver.h"
+#include "Optimizer.h"
+#include "Compiler.h"
+#include "VM.h"
+#include "Heap.h"
+#include "Output.h"
 using namespace std;
 
 // Initialize static members
 bool Lox::hadError = false;
 bool Lox::hadRuntimeError = false;
+LoxOptions Lox::options;
 
-void Lox::run(string source) {
-    Scanner scanner(source);
+void Lox::run(const string& source) {
+    // String literals are interned while scanning and stay alive as long as
+    // the tree that refers to them
+    PinnedValues literals(Heap::instance());
+    Scanner scanner(source, literals);
     vector<Token> tokens = scanner.scanTokens();
-    
-    // Print all tokens
-    cout << "Tokens:" << endl;
-    for(const Token& token : tokens) {
-        cout << token << endl;
+
+    if (options.dumpTokens) {
+        for(const Token& token : tokens) {
+            Output::write(token.toString());
+            Output::newline();
+        }
     }
 
-    // Parse tokens into statements
-    Parser parser(tokens);
-    vector<shared_ptr<Stmt>> statements = parser.parse();
+    // Parse tokens into statements; the arena owns the tree until we return
+    Arena arena;
+    Parser parser(tokens, arena);
+    vector<Stmt*> statements = parser.parse();
 
     // Stop if there was a parsing error
     if(hadError)
         return;
 
-    // Create the interpreter
-    Interpreter interpreter;
-    
     // Run the resolver
-    Resolver resolver(interpreter);
+    Resolver resolver;
     resolver.resolve(statements);
     
     // Stop if there was a resolution error
     if(hadError)
         return;
 
-    // Interpret the statements
-    if (!statements.empty()) {
-        cout << "\nInterpreted Result:" << endl;
-        interpreter.interpret(statements);
+    if (options.dumpAst) {
+        AstPrinter printer;
+        Output::write(printer.print(statements));
+    }
+
+    // Fold constants and drop dead branches before either engine sees the tree
+    Optimizer optimizer(arena, literals);
+    optimizer.optimize(statements);
+
+    if (options.dumpOptimizedAst) {
+        AstPrinter printer;
+        Output::write(printer.print(statements));
     }
+
+    if (options.useVm) {
+        // Lower the program to bytecode and run it on the VM
+        VM vm(options.maxCallDepth);
+        Compiler compiler(vm);
+        VmFunction* script = compiler.compile(statements);
+        if(hadError)
+            return;
+
+        vm.interpret(script);
+        return;
+    }
+
+    // Create the interpreter and run the statements
+    Interpreter interpreter(options.maxCallDepth);
+    interpreter.interpret(statements, resolver.scriptFrameSize());
 }
 
 void Lox::runPrompt() {
     string input;
     while(true) {
-        cout << "> ";
+        Output::write("> ");
+        Output::flush();
         getline(cin, input);
         if(input.empty() || input == "exit")
             break;
@@ -63,6 +97,7 @@ void Lox::runPrompt() {
         hadError = false;
         hadRuntimeError = false;
     }
+    reportHeapStats();
 }
 
 string Lox::readFile(const string& path) {
@@ -86,30 +121,124 @@ string Lox::readFile(const string& path) {
 void Lox::runFile(string path) {
     string content = readFile(path);
     run(content);
+    reportHeapStats();
     if(hadError)
         exit(65);
     if(hadRuntimeError)
         exit(70);
 }
 
+void Lox::configureHeap() {
+    Heap::instance().setGrowthFactor(options.gcGrowthFactor);
+}
+
+void Lox::reportHeapStats() {
+    if(options.gcStats) {
+        Output::flush();
+        Heap::instance().printStats(cerr);
+    }
+}
+
 void Lox::error(int line, string message) {
     report(line, "", message);
 }
 
-void Lox::error(Token token, string message) {
+void Lox::error(const Token& token, string message) {
     if (token.type == EOF_TOKEN) {
         report(token.line, " at end", message);
     } else {
-        report(token.line, " at '" + token.lexeme + "'", message);
+        report(token.line, " at '" + string(token.lexeme) + "'", message);
     }
 }
 
 void Lox::runtimeError(const RuntimeError& error) {
-    cerr << error.what() << "\n[line " << error.getToken().line << "]" << endl;
+    Output::flush();
+    cerr << error.what() << "\n";
+    const vector<TraceFrame>& trace = error.getCallTrace();
+    if (trace.empty()) {
+        cerr << "[line " << error.getToken().line << "]" << endl;
+        hadRuntimeError = true;
+        return;
+    }
+
+    printCallTrace(trace);
+    cerr << flush;
     hadRuntimeError = true;
 }
 
+static bool sameFrame(const TraceFrame& a, const TraceFrame& b) {
+    return a.line == b.line && a.function == b.function;
+}
+
+void Lox::printCallTrace(const vector<TraceFrame>& trace) {
+    // Runaway recursion goes round the same cycle of calls over and over,
+    // which is only shown once. Each group is a run of calls and how many
+    // more times it repeats straight after; a run that only comes up twice
+    // is as likely chance as a cycle.
+    struct Group {
+        size_t start;
+        size_t length;
+        size_t repeats;
+    };
+    const size_t MAX_CYCLE = 16;
+    vector<Group> groups;
+    for (size_t i = 0; i < trace.size();) {
+        Group best{i, 1, 0};
+        for (size_t length = 1; length <= MAX_CYCLE && i + 2 * length <= trace.size(); length++) {
+            size_t repeats = 0;
+            size_t next = i + length;
+            while (next + length <= trace.size() &&
+                   equal(trace.begin() + i, trace.begin() + i + length, trace.begin() + next, sameFrame)) {
+                repeats++;
+                next += length;
+            }
+            if (repeats >= 2 && repeats * length > best.repeats * best.length) {
+                best = Group{i, length, repeats};
+            }
+        }
+        groups.push_back(best);
+        i += best.length * (best.repeats + 1);
+    }
+
+    // Whatever doesn't fold is cut down to about as many lines from each
+    // end, innermost and outermost, which always fits a whole folded cycle
+    const size_t SHOWN_LINES = MAX_CYCLE + 1;
+    auto lineCount = [](const Group& group) { return group.length + (group.repeats > 0 ? 1 : 0); };
+    size_t innerEnd = 0;
+    for (size_t lines = 0; innerEnd < groups.size() && lines + lineCount(groups[innerEnd]) <= SHOWN_LINES; innerEnd++) {
+        lines += lineCount(groups[innerEnd]);
+    }
+    size_t outerStart = groups.size();
+    for (size_t lines = 0; outerStart > innerEnd && lines + lineCount(groups[outerStart - 1]) <= SHOWN_LINES; outerStart--) {
+        lines += lineCount(groups[outerStart - 1]);
+    }
+
+    for (size_t g = 0; g < groups.size(); g++) {
+        if (g == innerEnd && innerEnd < outerStart) {
+            size_t skipped = 0;
+            for (; g < outerStart; g++) {
+                skipped += groups[g].length * (groups[g].repeats + 1);
+            }
+            cerr << "  ... " << skipped << " more calls\n";
+            if (g == groups.size()) break;
+        }
+
+        const Group& group = groups[g];
+        for (size_t i = group.start; i < group.start + group.length; i++) {
+            cerr << "[line " << trace[i].line << "] in "
+                 << (trace[i].function.empty() ? "script" : trace[i].function + "()") << "\n";
+        }
+        if (group.repeats == 0) continue;
+        if (group.length == 1) {
+            cerr << "  (repeated " << group.repeats << " more times)\n";
+        } else {
+            cerr << "  (these " << group.length << " calls repeated " << group.repeats << " more times)\n";
+        }
+    }
+}
+
 void Lox::report(int line, string where, string message) {
+    Output::flush();
     cerr << "[line " << line << "] Error" << where << ": " << message << "\n";
     hadError = true;
 } 
\ No newline at end of file
@@ -2,10 +2,26 @@
 #define LOX_H
 
 #include <string>
+#include <vector>
 #include "Token.h"
 
 // Forward declare RuntimeError
 class RuntimeError;
+struct TraceFrame;
+
+// Settings chosen on the command line
+struct LoxOptions {
+    bool useVm = false;  // Run on the bytecode VM instead of the tree-walker
+    bool dumpTokens = false;  // Print every token before parsing
+    bool dumpAst = false;  // Print the resolved syntax tree before running
+    bool dumpOptimizedAst = false;  // Print the tree again after the Optimizer
+    bool gcStats = false;  // Print collector statistics to stderr when done
+    double gcGrowthFactor = 2.0;  // Heap growth allowed after each collection
+    // Lox calls that may be nested before a stack overflow is raised. The
+    // tree-walker also raises one when the native stack runs low, which
+    // deeply nested expressions can make happen sooner.
+    int maxCallDepth = 1024;
+};
 
 class Lox {
 private:
@@ -13,13 +29,21 @@ private:
     static bool hadRuntimeError;
     static std::string readFile(const std::string& path);
     static void report(int line, std::string where, std::string message);
+    static void reportHeapStats();
+    // Prints a runtime error's call trace, folding repeated calls
+    static void printCallTrace(const std::vector<TraceFrame>& trace);
 
 public:
-    static void run(std::string source);
+    static LoxOptions options;
+
+    // Applies the garbage collector settings from options
+    static void configureHeap();
+
+    static void run(const std::string& source);
     static void runPrompt();
     static void runFile(std::string path);
     static void error(int line, std::string message);
-    static void error(Token token, std::string message);
+    static void error(const Token& token, std::string message);
     static void runtimeError(const RuntimeError& error);
 };
 
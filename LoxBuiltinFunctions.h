@@ -2,9 +2,12 @@
 #define LOX_BUILTIN_FUNCTIONS_H
 
 #include <chrono>
-#include <memory>
-#include <unordered_map>
+#include <functional>
+#include <string>
+#include <string_view>
+#include "Heap.h"
 #include "LoxCallable.h"
+#include "LoxCollections.h"
 
 // Forward declaration
 class Interpreter;
@@ -12,7 +15,7 @@ class Interpreter;
 // Clock function for timing
 class ClockFunction : public LoxCallable {
 public:
-    Value call(Interpreter* interpreter, const std::vector<Value>& arguments) override {
+    Value call(Interpreter* interpreter, Value* arguments) override {
         // Return time in seconds since epoch
         auto now = std::chrono::system_clock::now();
         auto duration = now.time_since_epoch();
@@ -29,13 +32,108 @@ public:
     }
 };
 
-// Creates and returns all the built-in functions
-inline std::unordered_map<std::string, std::shared_ptr<LoxCallable>> getBuiltinFunctions() {
-    std::unordered_map<std::string, std::shared_ptr<LoxCallable>> builtins;
-    
-    builtins["clock"] = std::make_shared<ClockFunction>();
-    
-    return builtins;
+// len(value): the number of elements in a list, entries in a map or
+// characters in a string
+class LenFunction : public LoxCallable {
+public:
+    Value call(Interpreter*, Value* arguments) override {
+        const Value& value = arguments[0];
+        if (value.isList()) return Value(static_cast<double>(value.getList()->elements.size()));
+        if (value.isMap()) return Value(static_cast<double>(value.getMap()->count()));
+        if (value.isString()) return Value(static_cast<double>(value.getString().size()));
+        throw NativeError("Can only take the length of a list, map or string.");
+    }
+
+    int arity() const override { return 1; }
+
+    std::string toString() const override { return "<native fn: len>"; }
+};
+
+// push(list, value): appends value to the end of list
+class PushFunction : public LoxCallable {
+public:
+    Value call(Interpreter*, Value* arguments) override {
+        if (!arguments[0].isList()) throw NativeError("Can only push onto a list.");
+        arguments[0].getList()->push(arguments[1]);
+        return Value();
+    }
+
+    int arity() const override { return 2; }
+
+    std::string toString() const override { return "<native fn: push>"; }
+};
+
+// pop(list): removes and returns the last element of list
+class PopFunction : public LoxCallable {
+public:
+    Value call(Interpreter*, Value* arguments) override {
+        if (!arguments[0].isList()) throw NativeError("Can only pop from a list.");
+        std::vector<Value>& elements = arguments[0].getList()->elements;
+        if (elements.empty()) throw NativeError("Can't pop from an empty list.");
+        Value last = elements.back();
+        elements.pop_back();
+        return last;
+    }
+
+    int arity() const override { return 1; }
+
+    std::string toString() const override { return "<native fn: pop>"; }
+};
+
+// keys(map): a new list of the keys in map
+class KeysFunction : public LoxCallable {
+public:
+    Value call(Interpreter*, Value* arguments) override {
+        if (!arguments[0].isMap()) throw NativeError("Can only list the keys of a map.");
+        return Value(Heap::instance().allocate<LoxList>(arguments[0].getMap()->keys()));
+    }
+
+    int arity() const override { return 1; }
+
+    std::string toString() const override { return "<native fn: keys>"; }
+};
+
+// has(map, key): whether map has an entry for key
+class HasFunction : public LoxCallable {
+public:
+    Value call(Interpreter*, Value* arguments) override {
+        if (!arguments[0].isMap()) throw NativeError("Can only look keys up in a map.");
+        Value value;
+        return Value(arguments[0].getMap()->get(arguments[1], value));
+    }
+
+    int arity() const override { return 2; }
+
+    std::string toString() const override { return "<native fn: has>"; }
+};
+
+// remove(map, key): deletes the entry for key, returning its value or nil
+class RemoveFunction : public LoxCallable {
+public:
+    Value call(Interpreter*, Value* arguments) override {
+        if (!arguments[0].isMap()) throw NativeError("Can only remove keys from a map.");
+        Value removed;
+        arguments[0].getMap()->remove(arguments[1], removed);
+        return removed;
+    }
+
+    int arity() const override { return 2; }
+
+    std::string toString() const override { return "<native fn: remove>"; }
+};
+
+// Creates the built-in functions and hands each to define. They are defined
+// one at a time so every function is rooted before the next is allocated.
+inline void defineBuiltinFunctions(const std::function<void(std::string_view, const Value&)>& define) {
+    Heap& heap = Heap::instance();
+
+    define("clock", Value(heap.allocate<ClockFunction>()));
+    define("len", Value(heap.allocate<LenFunction>()));
+    define("push", Value(heap.allocate<PushFunction>()));
+    define("pop", Value(heap.allocate<PopFunction>()));
+    define("keys", Value(heap.allocate<KeysFunction>()));
+    define("has", Value(heap.allocate<HasFunction>()));
+    define("remove", Value(heap.allocate<RemoveFunction>()));
 }
 
 #endif // LOX_BUILTIN_FUNCTIONS_H 
\ No newline at end of file
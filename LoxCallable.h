@@ -1,18 +1,32 @@
 #ifndef LOX_CALLABLE_H
 #define LOX_CALLABLE_H
 
-#include <vector>
+#include <stdexcept>
+#include "Object.h"
 #include "Value.h"
 
 // Forward declarations
 class Interpreter;
+class LoxFunction;
 
-class LoxCallable {
+// Thrown by native functions when they are called with the wrong kinds of
+// arguments. The engine making the call reports it as a runtime error at the
+// call site.
+class NativeError : public std::runtime_error {
 public:
-    virtual ~LoxCallable() = default;
-    virtual Value call(Interpreter* interpreter, const std::vector<Value>& arguments) = 0;
+    using std::runtime_error::runtime_error;
+};
+
+class LoxCallable : public Obj {
+public:
+    LoxCallable() : Obj(OBJ_CALLABLE) {}
+    // The arity() arguments are in place on the calling engine's stack
+    virtual Value call(Interpreter* interpreter, Value* arguments) = 0;
     virtual int arity() const = 0;  // Number of arguments the function expects
     virtual std::string toString() const = 0;
+
+    // Lox functions, unlike natives, can be called in tail position
+    virtual LoxFunction* asFunction() { return nullptr; }
 };
 
-#endif // LOX_CALLABLE_H 
\ No newline at end of file
+#endif // LOX_CALLABLE_H 
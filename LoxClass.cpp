@@ -0,0 +1,118 @@
+#include "LoxClass.h"
+#include "Heap.h"
+
+using namespace std;
+
+// Zero marks an empty PropertyCache
+uint64_t Shape::nextId = 1;
+
+Shape::Shape(LoxClass* klass) : Obj(OBJ_SHAPE), id(nextId++), klass(klass) {}
+
+Shape* Shape::withField(ObjString* name) {
+    auto it = transitions.find(name);
+    if (it != transitions.end()) return it->second;
+
+    // The caller keeps this shape and the name reachable
+    Shape* next = Heap::instance().allocate<Shape>(klass);
+    next->slots = slots;
+    next->slots[name] = static_cast<int>(slots.size());
+    transitions[name] = next;
+    return next;
+}
+
+void Shape::trace(Heap& heap) {
+    heap.markObject(klass);
+    for (const auto& entry : slots) {
+        heap.markObject(entry.first);
+    }
+    for (const auto& entry : transitions) {
+        heap.markObject(entry.first);
+        heap.markObject(entry.second);
+    }
+}
+
+void LoxClass::addMethod(ObjString* name, Obj* method) {
+    methods[name] = method;
+    if (name->chars == "init") initializer = method;
+}
+
+void LoxClass::inherit(LoxClass* superclass) {
+    this->superclass = superclass;
+    methods = superclass->methods;
+    initializer = superclass->initializer;
+}
+
+Shape* LoxClass::instanceShape() {
+    if (rootShape == nullptr) {
+        rootShape = Heap::instance().allocate<Shape>(this);
+    }
+    return rootShape;
+}
+
+void LoxClass::trace(Heap& heap) {
+    heap.markObject(superclass);
+    for (const auto& entry : methods) {
+        heap.markObject(entry.first);
+        heap.markObject(entry.second);
+    }
+    heap.markObject(rootShape);
+}
+
+PropertyKind LoxInstance::getPropertySlow(string_view chars, PropertyCache& cache, Value& result) {
+    // A name that was never interned can't be a field or method name
+    ObjString* name = Heap::instance().findString(chars);
+    if (name == nullptr) return PropertyKind::UNDEFINED;
+
+    int slot = shape->slotOf(name);
+    if (slot >= 0) {
+        cache = PropertyCache{shape->id, slot, nullptr, nullptr};
+        result = fields[slot];
+        return PropertyKind::FIELD;
+    }
+
+    Obj* method = klass()->findMethod(name);
+    if (method == nullptr) return PropertyKind::UNDEFINED;
+
+    cache = PropertyCache{shape->id, -1, method, nullptr};
+    result = Value(method);
+    return PropertyKind::METHOD;
+}
+
+void LoxInstance::setPropertySlow(string_view chars, const Value& value, PropertyCache& cache) {
+    Heap& heap = Heap::instance();
+    ObjString* name = heap.intern(chars);
+
+    int slot = shape->slotOf(name);
+    if (slot >= 0) {
+        cache = PropertyCache{shape->id, slot, nullptr, nullptr};
+        fields[slot] = value;
+        return;
+    }
+
+    TempRoots roots(heap);
+    roots.add(Value(name));
+    Shape* next = shape->withField(name);
+    cache = PropertyCache{shape->id, static_cast<int>(fields.size()), nullptr, next};
+    shape = next;
+    appendField(value);
+}
+
+void LoxInstance::appendField(const Value& value) {
+    size_t capacity = fields.capacity();
+    fields.push_back(value);
+    if (fields.capacity() != capacity) {
+        Heap::instance().charge(this, (fields.capacity() - capacity) * sizeof(Value));
+    }
+}
+
+void LoxInstance::trace(Heap& heap) {
+    heap.markObject(shape);
+    for (const Value& field : fields) {
+        heap.markValue(field);
+    }
+}
+
+void LoxBoundMethod::trace(Heap& heap) {
+    heap.markValue(receiver);
+    heap.markObject(method);
+}
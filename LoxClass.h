@@ -0,0 +1,156 @@
+#ifndef LOX_CLASS_H
+#define LOX_CLASS_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "Object.h"
+#include "Value.h"
+
+class LoxClass;
+class Shape;
+
+// Inline cache kept at every property access site: in the syntax tree for
+// the Interpreter and in the Chunk for the VM. It remembers the last shape
+// seen at the site and where the property was found for it, so repeated
+// accesses to objects laid out the same way skip the lookup entirely.
+//
+// Shape ids are never reused, so a stale entry can never match and the
+// cache needs no marking: on a hit the instance's shape, and with it the
+// class, methods and transitions the entry points at, is still alive.
+struct PropertyCache {
+    uint64_t shapeId = 0;         // 0 while the cache is empty
+    int slot = -1;                // Field slot, or -1 for a method
+    Obj* method = nullptr;        // Reads: the method found on the class
+    Shape* transition = nullptr;  // Writes that add the field: the shape that results
+};
+
+// Hidden class: the field layout shared by every instance of a class that
+// gained the same fields in the same order. Adding a field moves the
+// instance along a transition to the next shape, so instances only carry
+// their field values, never their own table of names.
+class Shape : public Obj {
+public:
+    const uint64_t id;
+    LoxClass* const klass;
+
+    explicit Shape(LoxClass* klass);
+
+    // Slot of a field, or -1 if instances of this shape don't have it
+    int slotOf(ObjString* name) const {
+        auto it = slots.find(name);
+        return it == slots.end() ? -1 : it->second;
+    }
+    size_t fieldCount() const { return slots.size(); }
+
+    // The shape after adding a field, created the first time it is needed
+    Shape* withField(ObjString* name);
+
+    void trace(Heap& heap) override;
+
+private:
+    static uint64_t nextId;
+
+    std::unordered_map<ObjString*, int> slots;
+    std::unordered_map<ObjString*, Shape*> transitions;
+};
+
+class LoxClass : public Obj {
+public:
+    const std::string name;
+    LoxClass* superclass = nullptr;
+    Obj* initializer = nullptr;  // The "init" method, if there is one
+
+    explicit LoxClass(std::string name) : Obj(OBJ_CLASS), name(std::move(name)) {}
+
+    // Methods are LoxFunctions in the Interpreter and VmClosures in the VM.
+    // Inheriting copies the superclass's methods down before the class adds
+    // its own, so lookups never walk up the chain.
+    Obj* findMethod(ObjString* name) const {
+        auto it = methods.find(name);
+        return it == methods.end() ? nullptr : it->second;
+    }
+    void addMethod(ObjString* name, Obj* method);
+    void inherit(LoxClass* superclass);
+
+    // Shape of a newly created instance. Allocates on first use.
+    Shape* instanceShape();
+
+    void trace(Heap& heap) override;
+
+private:
+    std::unordered_map<ObjString*, Obj*> methods;
+    Shape* rootShape = nullptr;
+};
+
+enum class PropertyKind {
+    UNDEFINED,
+    FIELD,
+    METHOD
+};
+
+class LoxInstance : public Obj {
+public:
+    Shape* shape;
+    std::vector<Value> fields;  // Indexed by the shape's slots
+
+    explicit LoxInstance(Shape* shape) : Obj(OBJ_INSTANCE), shape(shape) {}
+
+    LoxClass* klass() const { return shape->klass; }
+
+    // Looks a property up through the site's cache, fields shadowing
+    // methods. The field's value or the unbound method goes in result. The
+    // name is only needed when the cache misses.
+    PropertyKind getProperty(std::string_view name, PropertyCache& cache, Value& result) {
+        if (cache.shapeId == shape->id) {
+            if (cache.slot >= 0) {
+                result = fields[cache.slot];
+                return PropertyKind::FIELD;
+            }
+            result = Value(cache.method);
+            return PropertyKind::METHOD;
+        }
+        return getPropertySlow(name, cache, result);
+    }
+
+    // Sets a field through the site's cache, adding it if the instance
+    // doesn't have it yet. May allocate, so the caller must keep both the
+    // instance and the value reachable.
+    void setProperty(std::string_view name, const Value& value, PropertyCache& cache) {
+        if (cache.shapeId == shape->id) {
+            if (cache.transition == nullptr) {
+                fields[cache.slot] = value;
+            } else {
+                shape = cache.transition;
+                appendField(value);
+            }
+            return;
+        }
+        setPropertySlow(name, value, cache);
+    }
+
+    void trace(Heap& heap) override;
+    size_t extraSize() const override { return fields.capacity() * sizeof(Value); }
+
+private:
+    PropertyKind getPropertySlow(std::string_view name, PropertyCache& cache, Value& result);
+    void setPropertySlow(std::string_view name, const Value& value, PropertyCache& cache);
+    void appendField(const Value& value);
+};
+
+// A method read off an instance, which remembers the instance as its receiver
+class LoxBoundMethod : public Obj {
+public:
+    const Value receiver;
+    Obj* const method;
+
+    LoxBoundMethod(const Value& receiver, Obj* method) : Obj(OBJ_BOUND_METHOD), receiver(receiver), method(method) {}
+
+    std::string toString() const { return Value(method).toString(); }
+
+    void trace(Heap& heap) override;
+};
+
+#endif // LOX_CLASS_H
@@ -0,0 +1,237 @@
+#include "LoxCollections.h"
+#include "Heap.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace std;
+
+// Collections being printed, so one that contains itself prints as [...]
+// or {...} instead of recursing forever
+static vector<const Obj*> printing;
+
+static bool isPrinting(const Obj* object) {
+    return find(printing.begin(), printing.end(), object) != printing.end();
+}
+
+// Strings are quoted inside collections so ["a, b"] and ["a", "b"] differ
+static string elementString(const Value& value) {
+    if (value.isString()) return "\"" + value.getString() + "\"";
+    return value.toString();
+}
+
+void LoxList::push(const Value& value) {
+    size_t capacity = elements.capacity();
+    elements.push_back(value);
+    if (elements.capacity() != capacity) {
+        Heap::instance().charge(this, (elements.capacity() - capacity) * sizeof(Value));
+    }
+}
+
+string LoxList::toString() const {
+    if (isPrinting(this)) return "[...]";
+    printing.push_back(this);
+
+    string result = "[";
+    for (size_t i = 0; i < elements.size(); i++) {
+        if (i > 0) result += ", ";
+        result += elementString(elements[i]);
+    }
+
+    printing.pop_back();
+    return result + "]";
+}
+
+void LoxList::trace(Heap& heap) {
+    for (const Value& element : elements) {
+        heap.markValue(element);
+    }
+}
+
+uint32_t LoxMap::hashKey(const Value& key) {
+    if (key.isNumber()) {
+        double number = key.asNumber();
+        if (number == 0) number = 0;  // -0 equals 0, so it has to hash the same
+        uint64_t bits;
+        memcpy(&bits, &number, sizeof(double));
+        // Mix the high bits down; small integers differ only in the exponent
+        // and top of the mantissa
+        bits ^= bits >> 33;
+        bits *= 0xff51afd7ed558ccdull;
+        bits ^= bits >> 33;
+        return static_cast<uint32_t>(bits);
+    }
+    if (key.isObj()) {
+        Obj* object = key.asObj();
+        if (object->type == OBJ_STRING) return static_cast<ObjString*>(object)->hash;
+        if (object->type == OBJ_ROPE) return ObjString::hashChars(key.getString());
+        uint64_t address = reinterpret_cast<uintptr_t>(object);
+        return static_cast<uint32_t>((address >> 4) ^ (address >> 32));
+    }
+    if (key.isNil()) return 1;
+    return key.getBoolean() ? 3 : 2;
+}
+
+size_t LoxMap::findEntry(const Value& key, uint32_t hash) const {
+    size_t mask = entries.size() - 1;
+    size_t index = hash & mask;
+    size_t tombstone = entries.size();
+    for (;;) {
+        const Entry& entry = entries[index];
+        if (entry.state == EntryState::EMPTY) {
+            return tombstone != entries.size() ? tombstone : index;
+        }
+        if (entry.state == EntryState::TOMBSTONE) {
+            if (tombstone == entries.size()) tombstone = index;
+        } else if (entry.key.equals(key)) {
+            return index;
+        }
+        index = (index + 1) & mask;
+    }
+}
+
+bool LoxMap::get(const Value& key, Value& value) const {
+    if (liveCount == 0) return false;
+
+    const Entry& entry = entries[findEntry(key, hashKey(key))];
+    if (entry.state != EntryState::LIVE) return false;
+    value = entry.value;
+    return true;
+}
+
+bool LoxMap::set(const Value& key, const Value& value) {
+    // Keep at least a quarter of the table empty so probes stay short and
+    // always end. Tombstones count, since they don't end a probe either.
+    if ((usedCount + 1) * 4 > entries.size() * 3) {
+        // A table that is mostly tombstones only needs rehashing, not growing
+        size_t capacity = max(MIN_CAPACITY, entries.size());
+        if ((liveCount + 1) * 2 > capacity) capacity *= 2;
+        resize(capacity);
+    }
+
+    Entry& entry = entries[findEntry(key, hashKey(key))];
+    if (entry.state == EntryState::LIVE) {
+        entry.value = value;
+        return false;
+    }
+
+    if (entry.state == EntryState::EMPTY) usedCount++;
+    liveCount++;
+    entry = Entry{key, value, EntryState::LIVE};
+    return true;
+}
+
+bool LoxMap::remove(const Value& key, Value& removed) {
+    if (liveCount == 0) return false;
+
+    Entry& entry = entries[findEntry(key, hashKey(key))];
+    if (entry.state != EntryState::LIVE) return false;
+
+    removed = entry.value;
+    entry = Entry{Value(), Value(), EntryState::TOMBSTONE};
+    liveCount--;
+    return true;
+}
+
+void LoxMap::resize(size_t capacity) {
+    // Rehashing into a fresh table also drops the tombstones
+    vector<Entry> old(capacity);
+    old.swap(entries);
+    usedCount = liveCount;
+    for (const Entry& entry : old) {
+        if (entry.state != EntryState::LIVE) continue;
+        entries[findEntry(entry.key, hashKey(entry.key))] = entry;
+    }
+
+    if (entries.capacity() > old.capacity()) {
+        Heap::instance().charge(this, (entries.capacity() - old.capacity()) * sizeof(Entry));
+    }
+}
+
+vector<Value> LoxMap::keys() const {
+    vector<Value> result;
+    result.reserve(liveCount);
+    for (const Entry& entry : entries) {
+        if (entry.state == EntryState::LIVE) result.push_back(entry.key);
+    }
+    return result;
+}
+
+string LoxMap::toString() const {
+    if (isPrinting(this)) return "{...}";
+    printing.push_back(this);
+
+    string result = "{";
+    bool first = true;
+    for (const Entry& entry : entries) {
+        if (entry.state != EntryState::LIVE) continue;
+        if (!first) result += ", ";
+        first = false;
+        result += elementString(entry.key) + ": " + elementString(entry.value);
+    }
+
+    printing.pop_back();
+    return result + "}";
+}
+
+void LoxMap::trace(Heap& heap) {
+    for (const Entry& entry : entries) {
+        if (entry.state != EntryState::LIVE) continue;
+        heap.markValue(entry.key);
+        heap.markValue(entry.value);
+    }
+}
+
+// Checks a list index, returning the error to report if it is unusable
+static const char* checkListIndex(const vector<Value>& elements, const Value& index, size_t& position) {
+    if (!index.isNumber() || index.asNumber() != std::floor(index.asNumber())) {
+        return "List index must be an integer.";
+    }
+    double number = index.asNumber();
+    if (number < 0 || number >= static_cast<double>(elements.size())) {
+        return "List index out of range.";
+    }
+    position = static_cast<size_t>(number);
+    return nullptr;
+}
+
+const char* getIndex(const Value& object, const Value& index, Value& result) {
+    if (object.isList()) {
+        const vector<Value>& elements = object.getList()->elements;
+        size_t position;
+        if (const char* message = checkListIndex(elements, index, position)) return message;
+        result = elements[position];
+        return nullptr;
+    }
+
+    if (object.isMap()) {
+        result = Value();
+        object.getMap()->get(index, result);
+        return nullptr;
+    }
+
+    return "Only lists and maps can be indexed.";
+}
+
+const char* setIndex(const Value& object, const Value& index, const Value& value) {
+    if (object.isList()) {
+        vector<Value>& elements = object.getList()->elements;
+        size_t position;
+        if (const char* message = checkListIndex(elements, index, position)) return message;
+        elements[position] = value;
+        return nullptr;
+    }
+
+    if (object.isMap()) {
+        object.getMap()->set(index, value);
+        return nullptr;
+    }
+
+    return "Only lists and maps can be indexed.";
+}
+
+LoxList* iterationList(const Value& sequence) {
+    if (sequence.isList()) return sequence.getList();
+    if (sequence.isMap()) return Heap::instance().allocate<LoxList>(sequence.getMap()->keys());
+    return nullptr;
+}
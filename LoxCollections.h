@@ -0,0 +1,88 @@
+#ifndef LOX_COLLECTIONS_H
+#define LOX_COLLECTIONS_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Object.h"
+#include "Value.h"
+
+// Growable array. The elements sit in one contiguous vector, so indexing is
+// a bounds check and a load and pushing is amortized O(1).
+class LoxList : public Obj {
+public:
+    std::vector<Value> elements;
+
+    LoxList() : Obj(OBJ_LIST) {}
+    explicit LoxList(std::vector<Value> elements) : Obj(OBJ_LIST), elements(std::move(elements)) {}
+
+    // Appends, charging the heap when the storage grows. Never collects.
+    void push(const Value& value);
+
+    std::string toString() const;
+
+    void trace(Heap& heap) override;
+    size_t extraSize() const override { return elements.capacity() * sizeof(Value); }
+};
+
+// Hash map from any value to any value. Entries live in a single array
+// probed linearly from the key's hash; removed entries leave a tombstone so
+// later probes keep going past them. Keys match with Value::equals, so
+// numbers compare by value and strings by their characters.
+class LoxMap : public Obj {
+public:
+    LoxMap() : Obj(OBJ_MAP) {}
+
+    size_t count() const { return liveCount; }
+
+    // Looks a key up, leaving value alone if the map doesn't have it
+    bool get(const Value& key, Value& value) const;
+    // Adds or replaces an entry, charging the heap when the table grows.
+    // Never collects. Returns true if the key is new.
+    bool set(const Value& key, const Value& value);
+    bool remove(const Value& key, Value& removed);
+
+    // Every key, in table order
+    std::vector<Value> keys() const;
+
+    std::string toString() const;
+
+    void trace(Heap& heap) override;
+    size_t extraSize() const override { return entries.capacity() * sizeof(Entry); }
+
+private:
+    enum class EntryState : uint8_t { EMPTY, LIVE, TOMBSTONE };
+
+    struct Entry {
+        Value key;
+        Value value;
+        EntryState state = EntryState::EMPTY;
+    };
+
+    static constexpr size_t MIN_CAPACITY = 8;
+
+    std::vector<Entry> entries;  // Size is zero or a power of two
+    size_t liveCount = 0;
+    size_t usedCount = 0;        // Live entries plus tombstones
+
+    static uint32_t hashKey(const Value& key);
+
+    // Index of the entry holding key, or of the one it should go in: the
+    // first tombstone passed on the way, or else the empty entry that ended
+    // the probe. The table must not be empty.
+    size_t findEntry(const Value& key, uint32_t hash) const;
+    void resize(size_t capacity);
+};
+
+// Indexing and iteration shared by both engines. Misuse is returned as the
+// message of the runtime error to raise at the brackets; null means success.
+// Maps answer nil for keys they don't have.
+const char* getIndex(const Value& object, const Value& index, Value& result);
+const char* setIndex(const Value& object, const Value& index, const Value& value);
+
+// What a for-each loop walks: a list itself, or a new list of a map's keys so
+// the loop body may change the map. Null for anything else. May allocate, so
+// the caller keeps sequence reachable.
+LoxList* iterationList(const Value& sequence);
+
+#endif // LOX_COLLECTIONS_H
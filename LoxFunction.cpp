@@ -1,24 +1,23 @@
 #include "LoxFunction.h"
 #include "Interpreter.h"
-#include "ReturnException.h"
+#include "Heap.h"
 
-Value LoxFunction::call(Interpreter* interpreter, const std::vector<Value>& arguments) {
-    // Create a new environment for the function execution
-    Environment* environment = new Environment(*closure);
-    
-    // Bind parameters to arguments
-    for (size_t i = 0; i < declaration.params.size(); i++) {
-        environment->define(declaration.params[i]->lexeme, arguments[i]);
+Value LoxFunction::invoke(Interpreter* interpreter, const Value& receiver, Value* arguments) {
+    // A call in tail position takes over the frame, including the slot
+    // keeping this function alive, so nothing here is used after the call
+    bool initializer = declaration->isInitializer();
+    ExecStatus status = interpreter->executeCall(this, receiver, arguments);
+    if (initializer) {
+        return receiver;
     }
-    
-    try {
-        // Execute the function body
-        interpreter->executeBlock(declaration.body, environment);
-    } catch (ReturnException& returnValue) {
-        // Handle return statements
-        return returnValue.value;
+    if (status == ExecStatus::RETURN) {
+        return interpreter->takeReturnValue();
     }
     
     // If we get here, the function didn't return a value
     return Value(); // Return nil
-} 
\ No newline at end of file
+}
+
+void LoxFunction::trace(Heap& heap) {
+    heap.markObject(closure);
+}
@@ -1,30 +1,47 @@
 #ifndef LOX_FUNCTION_H
 #define LOX_FUNCTION_H
 
-#include <memory>
 #include <string>
-#include <vector>
 #include "LoxCallable.h"
 #include "Stmt.h"
 #include "Environment.h"
 
+// A closure: a resolved function declaration paired with the environment it
+// was declared in. The declaration lives in the syntax tree's arena and is
+// never changed once resolved, so every closure made from it shares it and
+// creating one is a single small allocation.
 class LoxFunction : public LoxCallable {
 private:
-    Function declaration;
+    const Function* declaration;
     Environment* closure;  // The environment where the function was defined
 
 public:
-    LoxFunction(Function* declaration, Environment* closure)
-        : declaration(*declaration), closure(closure) {}
+    LoxFunction(const Function* declaration, Environment* closure)
+        : declaration(declaration), closure(closure) {}
+
+    const Function* getDeclaration() const { return declaration; }
+    Environment* getClosure() const { return closure; }
 
     // Implement LoxCallable interface
-    Value call(Interpreter* interpreter, const std::vector<Value>& arguments) override;
+    Value call(Interpreter* interpreter, Value* arguments) override {
+        return invoke(interpreter, Value(), arguments);
+    }
+    LoxFunction* asFunction() override { return this; }
+
+    // Calls the function as a method of receiver, which must stay reachable
+    // while the call's environment is allocated. The arguments are on the
+    // Interpreter's value stack, where they start the call's frame, just
+    // after the slot holding the callee. Initializers always return the
+    // receiver.
+    Value invoke(Interpreter* interpreter, const Value& receiver, Value* arguments);
     int arity() const override {
-        return declaration.params.size();
+        return declaration->params.size();
     }
     std::string toString() const override {
-        return "<fn " + declaration.name.lexeme + ">";
+        return "<fn " + std::string(declaration->name.lexeme) + ">";
     }
+
+    void trace(Heap& heap) override;
 };
 
 #endif // LOX_FUNCTION_H 
\ No newline at end of file
@@ -0,0 +1,43 @@
+#include "Object.h"
+#include "Heap.h"
+
+using namespace std;
+
+const string& ObjRope::flatten() {
+    if (left == nullptr) return flat;
+
+    string chars;
+    chars.reserve(length);
+
+    // Ropes built in a loop nest thousands deep on the left, so walk them
+    // with an explicit stack rather than recursion
+    vector<Obj*> pending = { right, left };
+    while (!pending.empty()) {
+        Obj* piece = pending.back();
+        pending.pop_back();
+
+        if (piece->type == OBJ_STRING) {
+            chars += static_cast<ObjString*>(piece)->chars;
+            continue;
+        }
+
+        ObjRope* rope = static_cast<ObjRope*>(piece);
+        if (rope->left == nullptr) {
+            chars += rope->flat;
+        } else {
+            pending.push_back(rope->right);
+            pending.push_back(rope->left);
+        }
+    }
+
+    flat = std::move(chars);
+    left = nullptr;
+    right = nullptr;
+    Heap::instance().charge(this, flat.capacity());
+    return flat;
+}
+
+void ObjRope::trace(Heap& heap) {
+    heap.markObject(left);
+    heap.markObject(right);
+}
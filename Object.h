@@ -0,0 +1,100 @@
+#ifndef OBJECT_H
+#define OBJECT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class Heap;
+
+// Kinds of heap object
+enum ObjType {
+    OBJ_STRING,
+    OBJ_ROPE,         // Concatenation not yet laid out as one string
+    OBJ_CALLABLE,     // Natives and tree-walker functions (LoxCallable)
+    OBJ_CLOSURE,      // Bytecode VM functions (VmClosure)
+    OBJ_ENVIRONMENT,  // Tree-walker scopes, never seen by Lox code
+    OBJ_FUNCTION,     // Compiled function prototypes (VmFunction)
+    OBJ_UPVALUE,      // Variables captured by VM closures (VmUpvalue)
+    OBJ_CLASS,        // LoxClass, shared by both engines
+    OBJ_INSTANCE,     // LoxInstance
+    OBJ_BOUND_METHOD, // LoxBoundMethod
+    OBJ_LIST,         // LoxList, shared by both engines
+    OBJ_MAP,          // LoxMap
+    OBJ_SHAPE         // Instance layouts, never seen by Lox code
+};
+
+// Base class for everything allocated on the garbage-collected Heap.
+// Objects are only ever created through Heap::allocate, which links them
+// into the heap's object list; the collector frees them once they are no
+// longer reachable from a root.
+class Obj {
+public:
+    const ObjType type;
+    bool marked = false;
+    size_t size = 0;       // Bytes charged to the heap for this object
+    Obj* next = nullptr;   // Next object in the heap's list of all objects
+
+    explicit Obj(ObjType type) : type(type) {}
+    Obj(const Obj&) = delete;
+    Obj& operator=(const Obj&) = delete;
+    virtual ~Obj() = default;
+
+    // Marks every object this one references
+    virtual void trace(Heap& heap) { (void)heap; }
+
+    // Memory owned outside the object itself, counted when it is allocated
+    virtual size_t extraSize() const { return 0; }
+};
+
+// Immutable string object. Strings are interned through Heap::intern, so
+// there is exactly one ObjString for any given contents and two strings are
+// equal exactly when they are the same object.
+class ObjString : public Obj {
+public:
+    const std::string chars;
+    const uint32_t hash;
+
+    ObjString(std::string chars, uint32_t hash) : Obj(OBJ_STRING), chars(std::move(chars)), hash(hash) {}
+
+    // FNV-1a over the characters
+    static uint32_t hashChars(std::string_view chars) {
+        uint32_t hash = 2166136261u;
+        for (char c : chars) {
+            hash ^= static_cast<uint8_t>(c);
+            hash *= 16777619u;
+        }
+        return hash;
+    }
+
+    size_t extraSize() const override { return chars.capacity(); }
+};
+
+// Lazy concatenation of two strings, each an ObjString or another ObjRope.
+// Building a long string a piece at a time links ropes instead of copying
+// everything built so far, and the characters are only laid out once, the
+// first time something reads them. Ropes are not interned.
+class ObjRope : public Obj {
+public:
+    // Shorter concatenations are copied and interned straight away
+    static constexpr size_t MIN_LENGTH = 64;
+
+    const size_t length;
+
+    ObjRope(Obj* left, Obj* right, size_t length) : Obj(OBJ_ROPE), length(length), left(left), right(right) {}
+
+    // Returns the characters, laying them out on the first call. The pieces
+    // are released afterwards.
+    const std::string& flatten();
+
+    void trace(Heap& heap) override;
+
+private:
+    Obj* left;   // Both null once flattened
+    Obj* right;
+    std::string flat;
+};
+
+#endif // OBJECT_H
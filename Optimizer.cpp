@@ -0,0 +1,259 @@
+#include "Optimizer.h"
+
+using namespace std;
+
+void Optimizer::optimize(vector<Stmt*>& statements) {
+    size_t kept = 0;
+    for (Stmt* statement : statements) {
+        Stmt* optimized = optimize(statement);
+        if (optimized != nullptr) statements[kept++] = optimized;
+    }
+    statements.resize(kept);
+}
+
+Expr* Optimizer::optimize(Expr* expr) {
+    exprResult = expr;
+    expr->accept(*this);
+    return exprResult;
+}
+
+Stmt* Optimizer::optimize(Stmt* stmt) {
+    stmtResult = stmt;
+    stmt->accept(*this);
+    return stmtResult;
+}
+
+Stmt* Optimizer::optimizeBranch(Stmt* stmt) {
+    Stmt* optimized = optimize(stmt);
+    return optimized != nullptr ? optimized : arena.make<Block>(vector<Stmt*>());
+}
+
+// Statement visitors
+void Optimizer::visitBlock(Block* stmt) {
+    optimize(stmt->statements);
+    stmtResult = stmt;
+}
+
+void Optimizer::visitClass(Class* stmt) {
+    for (Function* method : stmt->methods) {
+        optimize(method->body);
+    }
+    stmtResult = stmt;
+}
+
+void Optimizer::visitExpression(Expression* stmt) {
+    stmt->expression = optimize(stmt->expression);
+    // A literal on its own does nothing
+    stmtResult = dynamic_cast<LiteralExpr*>(stmt->expression) != nullptr ? nullptr : stmt;
+}
+
+void Optimizer::visitForEach(ForEach* stmt) {
+    stmt->iterable = optimize(stmt->iterable);
+    stmt->body = optimizeBranch(stmt->body);
+    stmtResult = stmt;
+}
+
+void Optimizer::visitFunction(Function* stmt) {
+    optimize(stmt->body);
+    stmtResult = stmt;
+}
+
+void Optimizer::visitIf(If* stmt) {
+    stmt->condition = optimize(stmt->condition);
+
+    if (LiteralExpr* condition = dynamic_cast<LiteralExpr*>(stmt->condition)) {
+        // Only one branch can ever run, and it keeps its own scope
+        Stmt* taken = condition->value.isTruthy() ? stmt->thenBranch : stmt->elseBranch;
+        stmtResult = taken != nullptr ? optimize(taken) : nullptr;
+        return;
+    }
+
+    stmt->thenBranch = optimizeBranch(stmt->thenBranch);
+    if (stmt->elseBranch != nullptr) {
+        stmt->elseBranch = optimize(stmt->elseBranch);
+    }
+    stmtResult = stmt;
+}
+
+void Optimizer::visitPrint(Print* stmt) {
+    stmt->expression = optimize(stmt->expression);
+    stmtResult = stmt;
+}
+
+void Optimizer::visitReturn(Return* stmt) {
+    if (stmt->value != nullptr) {
+        stmt->value = optimize(stmt->value);
+    }
+    stmtResult = stmt;
+}
+
+void Optimizer::visitVar(Var* stmt) {
+    if (stmt->initializer != nullptr) {
+        stmt->initializer = optimize(stmt->initializer);
+    }
+    stmtResult = stmt;
+}
+
+void Optimizer::visitWhile(While* stmt) {
+    stmt->condition = optimize(stmt->condition);
+
+    // A loop whose condition starts out false never runs its body
+    LiteralExpr* condition = dynamic_cast<LiteralExpr*>(stmt->condition);
+    if (condition != nullptr && !condition->value.isTruthy()) {
+        stmtResult = nullptr;
+        return;
+    }
+
+    stmt->body = optimizeBranch(stmt->body);
+    stmtResult = stmt;
+}
+
+// Expression visitors
+void Optimizer::visitAssign(Assign* expr) {
+    expr->value = optimize(expr->value);
+    exprResult = expr;
+}
+
+void Optimizer::visitBinary(Binary* expr) {
+    expr->left = optimize(expr->left);
+    expr->right = optimize(expr->right);
+    exprResult = expr;
+
+    LiteralExpr* leftLiteral = dynamic_cast<LiteralExpr*>(expr->left);
+    LiteralExpr* rightLiteral = dynamic_cast<LiteralExpr*>(expr->right);
+    if (leftLiteral == nullptr || rightLiteral == nullptr) return;
+    const Value& left = leftLiteral->value;
+    const Value& right = rightLiteral->value;
+
+    // Equality is defined for every pair of values
+    if (expr->op.type == EQUAL_EQUAL) {
+        exprResult = literal(Value(left == right));
+        return;
+    }
+    if (expr->op.type == BANG_EQUAL) {
+        exprResult = literal(Value(left != right));
+        return;
+    }
+
+    if (expr->op.type == PLUS && left.isString() && right.isString()) {
+        Value joined(Heap::instance().intern(left.getString() + right.getString()));
+        exprResult = literal(literals.add(joined));
+        return;
+    }
+
+    // Everything else needs two numbers; other operands are a runtime error
+    if (!left.isNumber() || !right.isNumber()) return;
+    double a = left.asNumber();
+    double b = right.asNumber();
+    switch (expr->op.type) {
+        case PLUS:          exprResult = literal(Value(a + b)); break;
+        case MINUS:         exprResult = literal(Value(a - b)); break;
+        case STAR:          exprResult = literal(Value(a * b)); break;
+        case SLASH:
+            if (b != 0) exprResult = literal(Value(a / b));
+            break;
+        case GREATER:       exprResult = literal(Value(a > b)); break;
+        case GREATER_EQUAL: exprResult = literal(Value(a >= b)); break;
+        case LESS:          exprResult = literal(Value(a < b)); break;
+        case LESS_EQUAL:    exprResult = literal(Value(a <= b)); break;
+        default:
+            break;
+    }
+}
+
+void Optimizer::visitCall(Call* expr) {
+    // Method calls keep their Get or Super callee, which the engines use to
+    // call without binding
+    expr->callee = optimize(expr->callee);
+    for (Expr*& argument : expr->arguments) {
+        argument = optimize(argument);
+    }
+    exprResult = expr;
+}
+
+void Optimizer::visitGet(Get* expr) {
+    expr->object = optimize(expr->object);
+    exprResult = expr;
+}
+
+void Optimizer::visitGrouping(Grouping* expr) {
+    // Parentheses only matter to the parser
+    exprResult = optimize(expr->expression);
+}
+
+void Optimizer::visitIndex(Index* expr) {
+    expr->object = optimize(expr->object);
+    expr->index = optimize(expr->index);
+    exprResult = expr;
+}
+
+void Optimizer::visitIndexSet(IndexSet* expr) {
+    expr->object = optimize(expr->object);
+    expr->index = optimize(expr->index);
+    expr->value = optimize(expr->value);
+    exprResult = expr;
+}
+
+void Optimizer::visitListLiteral(ListLiteral* expr) {
+    for (Expr*& element : expr->elements) {
+        element = optimize(element);
+    }
+    exprResult = expr;
+}
+
+void Optimizer::visitLiteralExpr(LiteralExpr* expr) {
+    exprResult = expr;
+}
+
+void Optimizer::visitLogical(Logical* expr) {
+    expr->left = optimize(expr->left);
+    expr->right = optimize(expr->right);
+    exprResult = expr;
+
+    // The result is one of the operands: a constant left operand either
+    // decides it or hands over to the right one
+    if (LiteralExpr* left = dynamic_cast<LiteralExpr*>(expr->left)) {
+        bool decided = expr->op.type == OR ? left->value.isTruthy() : !left->value.isTruthy();
+        exprResult = decided ? expr->left : expr->right;
+    }
+}
+
+void Optimizer::visitMapLiteral(MapLiteral* expr) {
+    for (size_t i = 0; i < expr->keys.size(); i++) {
+        expr->keys[i] = optimize(expr->keys[i]);
+        expr->values[i] = optimize(expr->values[i]);
+    }
+    exprResult = expr;
+}
+
+void Optimizer::visitSet(Set* expr) {
+    expr->object = optimize(expr->object);
+    expr->value = optimize(expr->value);
+    exprResult = expr;
+}
+
+void Optimizer::visitSuper(Super* expr) {
+    exprResult = expr;
+}
+
+void Optimizer::visitThis(This* expr) {
+    exprResult = expr;
+}
+
+void Optimizer::visitUnary(Unary* expr) {
+    expr->right = optimize(expr->right);
+    exprResult = expr;
+
+    LiteralExpr* right = dynamic_cast<LiteralExpr*>(expr->right);
+    if (right == nullptr) return;
+
+    if (expr->op.type == BANG) {
+        exprResult = literal(Value(!right->value.isTruthy()));
+    } else if (expr->op.type == MINUS && right->value.isNumber()) {
+        exprResult = literal(Value(-right->value.asNumber()));
+    }
+}
+
+void Optimizer::visitVariable(Variable* expr) {
+    exprResult = expr;
+}
@@ -0,0 +1,74 @@
+#ifndef OPTIMIZER_H
+#define OPTIMIZER_H
+
+#include <vector>
+#include "Expr.h"
+#include "Stmt.h"
+#include "Arena.h"
+#include "Heap.h"
+
+// Rewrites a resolved syntax tree before either engine runs it. Operators
+// whose operands are all literals are folded into a single literal, grouping
+// parentheses are dropped, and if/while statements whose condition is a
+// constant lose the branches that can never run.
+//
+// Anything that would raise a runtime error, like dividing by zero or adding
+// a number to a string, is left alone so the error still happens when (and
+// if) the code runs. Folding never removes a declaration from a scope, so
+// the slots the Resolver handed out stay valid.
+class Optimizer : public VoidExprVisitor, public StmtVisitor<void> {
+public:
+    // Strings made by folding are pinned in literals, like scanned ones
+    Optimizer(Arena& arena, PinnedValues& literals) : arena(arena), literals(literals) {}
+
+    // Optimizes a list of statements in place, dropping any that do nothing
+    void optimize(std::vector<Stmt*>& statements);
+
+    // Statement visitors
+    void visitBlock(Block* stmt) override;
+    void visitClass(Class* stmt) override;
+    void visitExpression(Expression* stmt) override;
+    void visitForEach(ForEach* stmt) override;
+    void visitFunction(Function* stmt) override;
+    void visitIf(If* stmt) override;
+    void visitPrint(Print* stmt) override;
+    void visitReturn(Return* stmt) override;
+    void visitVar(Var* stmt) override;
+    void visitWhile(While* stmt) override;
+
+    // Expression visitors
+    void visitAssign(Assign* expr) override;
+    void visitBinary(Binary* expr) override;
+    void visitCall(Call* expr) override;
+    void visitGet(Get* expr) override;
+    void visitGrouping(Grouping* expr) override;
+    void visitIndex(Index* expr) override;
+    void visitIndexSet(IndexSet* expr) override;
+    void visitListLiteral(ListLiteral* expr) override;
+    void visitLiteralExpr(LiteralExpr* expr) override;
+    void visitLogical(Logical* expr) override;
+    void visitMapLiteral(MapLiteral* expr) override;
+    void visitSet(Set* expr) override;
+    void visitSuper(Super* expr) override;
+    void visitThis(This* expr) override;
+    void visitUnary(Unary* expr) override;
+    void visitVariable(Variable* expr) override;
+
+private:
+    Arena& arena;  // Owns the tree, and the literals folding creates
+    PinnedValues& literals;
+
+    // What the node being visited is replaced with. A null statement does
+    // nothing and is dropped.
+    Expr* exprResult = nullptr;
+    Stmt* stmtResult = nullptr;
+
+    Expr* optimize(Expr* expr);
+    Stmt* optimize(Stmt* stmt);
+    // For places that need a statement even if it does nothing
+    Stmt* optimizeBranch(Stmt* stmt);
+
+    Expr* literal(const Value& value) { return arena.make<LiteralExpr>(value); }
+};
+
+#endif // OPTIMIZER_H
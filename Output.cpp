@@ -0,0 +1,94 @@
+#include "Output.h"
+#include "Value.h"
+#include <cerrno>
+#include <cstdlib>
+#include <csignal>
+#include <cstring>
+#include <unistd.h>
+
+using namespace std;
+
+char Output::buffer[Output::BUFFER_SIZE];
+size_t Output::length = 0;
+bool Output::lineBuffered = false;
+
+void Output::init() {
+    lineBuffered = isatty(STDOUT_FILENO);
+    atexit(flush);
+
+    // The handler runs on a stack of its own, since a crash may well be the
+    // main stack overflowing
+    static char signalStack[64 * 1024];
+    stack_t alternate = {};
+    alternate.ss_sp = signalStack;
+    alternate.ss_size = sizeof(signalStack);
+    sigaltstack(&alternate, nullptr);
+
+    struct sigaction action = {};
+    action.sa_handler = flushOnFatalSignal;
+    action.sa_flags = SA_ONSTACK | SA_RESETHAND;
+    sigemptyset(&action.sa_mask);
+    for (int signal : {SIGSEGV, SIGBUS, SIGILL, SIGFPE, SIGABRT}) {
+        sigaction(signal, &action, nullptr);
+    }
+}
+
+void Output::flushOnFatalSignal(int signal) {
+    // write(2) is safe in a signal handler; the buffer may be mid-update,
+    // but whatever made it in is still worth having. The handler is reset
+    // by now, so raising the signal again crashes as before.
+    writeAll(buffer, length);
+    raise(signal);
+}
+
+void Output::writeAll(const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t written = ::write(STDOUT_FILENO, data, size);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return;  // Nowhere left to report it; drop the output
+        }
+        data += written;
+        size -= written;
+    }
+}
+
+void Output::write(string_view text) {
+    if (length + text.size() > BUFFER_SIZE) {
+        flush();
+        // Too big to be worth copying
+        if (text.size() > BUFFER_SIZE) {
+            writeAll(text.data(), text.size());
+            return;
+        }
+    }
+    memcpy(buffer + length, text.data(), text.size());
+    length += text.size();
+}
+
+void Output::write(char c) {
+    if (length == BUFFER_SIZE) flush();
+    buffer[length++] = c;
+}
+
+void Output::newline() {
+    write('\n');
+    if (lineBuffered) flush();
+}
+
+void Output::flush() {
+    writeAll(buffer, length);
+    length = 0;
+}
+
+void Output::print(const Value& value) {
+    if (value.isString()) {
+        write(value.getString());
+    } else if (value.isNumber()) {
+        char digits[Value::NUMBER_BUFFER_SIZE];
+        write(string_view(digits, Value::formatNumber(value.asNumber(), digits)));
+    } else {
+        write(value.toString());
+    }
+    newline();
+}
@@ -0,0 +1,38 @@
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include <string_view>
+
+class Value;
+
+// Buffered standard output shared by both engines and the diagnostics.
+// Text collects in a large user-space buffer and goes out with write(2)
+// when the buffer fills, on flush(), and at every newline when stdout is a
+// terminal. Anything that writes to stderr must flush first so the two
+// streams stay in order.
+class Output {
+private:
+    static constexpr size_t BUFFER_SIZE = 64 * 1024;
+
+    static char buffer[BUFFER_SIZE];
+    static size_t length;
+    static bool lineBuffered;
+
+    static void writeAll(const char* data, size_t size);
+    static void flushOnFatalSignal(int signal);
+
+public:
+    // Checks whether stdout is a terminal and arranges a flush at exit, and
+    // on a crash, so what was printed before one isn't lost
+    static void init();
+
+    static void write(std::string_view text);
+    static void write(char c);
+    static void newline();
+    static void flush();
+
+    // Writes a value the way Lox's print shows it, without building a string
+    static void print(const Value& value);
+};
+
+#endif // OUTPUT_H
@@ -1,14 +1,15 @@
 #include "Parser.h"
-#include <memory> 
 #include <initializer_list> 
 #include "Lox.h"
 
 using namespace std;
 
-Parser::Parser(vector<Token>& tokens) : current(0), tokens(tokens) {}
+Parser::Parser(const vector<Token>& tokens, Arena& arena) : current(0), tokens(tokens), arena(arena) {}
 
-shared_ptr<Stmt> Parser::declaration() {
+Stmt* Parser::declaration() {
     try {
+        if(match({CLASS}))
+            return classDeclaration();
         if(match({FUN}))
             return function("function");
         if(match({VAR}))
@@ -20,7 +21,28 @@ shared_ptr<Stmt> Parser::declaration() {
     }
 }
 
-shared_ptr<Stmt> Parser::statement() {
+Stmt* Parser::classDeclaration() {
+    const Token& name = consume(IDENTIFIER, "Expect class name.");
+
+    Variable* superclass = nullptr;
+    if(match({LESS})) {
+        consume(IDENTIFIER, "Expect superclass name.");
+        superclass = arena.make<Variable>(previous());
+    }
+
+    consume(LEFT_BRACE, "Expect '{' before class body.");
+    vector<Function*> methods;
+    while(!check(RIGHT_BRACE) && !isAtEnd()) {
+        Function* method = static_cast<Function*>(function("method"));
+        method->isMethod = true;
+        methods.push_back(method);
+    }
+    consume(RIGHT_BRACE, "Expect '}' after class body.");
+
+    return arena.make<Class>(name, superclass, methods);
+}
+
+Stmt* Parser::statement() {
     if(match({IF}))
         return ifStatement();
     if(match({WHILE}))
@@ -32,36 +54,41 @@ shared_ptr<Stmt> Parser::statement() {
     if(match({RETURN}))
         return returnStatement();
     if(match({LEFT_BRACE}))
-        return make_shared<Block>(block());
+        return arena.make<Block>(block());
     return expressionStatement();
 }
 
-shared_ptr<Stmt> Parser::ifStatement() {
+Stmt* Parser::ifStatement() {
     consume(LEFT_PAREN, "Expect '(' after 'if'.");
-    shared_ptr<Expr> condition = expression();
+    Expr* condition = expression();
     consume(RIGHT_PAREN, "Expect ')' after if condition.");
 
-    shared_ptr<Stmt> thenBranch = statement();
-    shared_ptr<Stmt> elseBranch = nullptr;
+    Stmt* thenBranch = statement();
+    Stmt* elseBranch = nullptr;
     if(match({ELSE}))
         elseBranch = statement();
 
-    return make_shared<If>(condition, thenBranch, elseBranch);
+    return arena.make<If>(condition, thenBranch, elseBranch);
 }
 
-shared_ptr<Stmt> Parser::whileStatement() {
+Stmt* Parser::whileStatement() {
     consume(LEFT_PAREN, "Expect '(' after 'while'.");
-    shared_ptr<Expr> condition = expression();
+    Expr* condition = expression();
     consume(RIGHT_PAREN, "Expect ')' after condition.");
-    shared_ptr<Stmt> body = statement();
+    Stmt* body = statement();
 
-    return make_shared<While>(condition, body);
+    return arena.make<While>(condition, body);
 }
 
-shared_ptr<Stmt> Parser::forStatement() {
+Stmt* Parser::forStatement() {
     consume(LEFT_PAREN, "Expect '(' after 'for'.");
+
+    // "for (var name :" starts a loop over a list or map instead
+    if(check(VAR) && tokens[current + 1].type == IDENTIFIER && tokens[current + 2].type == COLON) {
+        return forEachStatement();
+    }
     
-    shared_ptr<Stmt> initializer;
+    Stmt* initializer;
     if(match({SEMICOLON})) {
         initializer = nullptr;
     } else if(match({VAR})) {
@@ -70,99 +97,110 @@ shared_ptr<Stmt> Parser::forStatement() {
         initializer = expressionStatement();
     }
 
-    shared_ptr<Expr> condition = nullptr;
+    Expr* condition = nullptr;
     if(!check(SEMICOLON)) {
         condition = expression();
     }
     consume(SEMICOLON, "Expect ';' after loop condition.");
 
-    shared_ptr<Expr> increment = nullptr;
+    Expr* increment = nullptr;
     if(!check(RIGHT_PAREN)) {
         increment = expression();
     }
     consume(RIGHT_PAREN, "Expect ')' after for clauses");
 
-    shared_ptr<Stmt> body = statement();
+    Stmt* body = statement();
 
     // Desugar for loop into a while loop
     if(increment != nullptr) {
         // Create a block that contains the body followed by the increment expression
-        vector<shared_ptr<Stmt>> bodyWithIncrement;
+        vector<Stmt*> bodyWithIncrement;
         bodyWithIncrement.push_back(body);
-        bodyWithIncrement.push_back(make_shared<Expression>(increment));
-        body = make_shared<Block>(bodyWithIncrement);
+        bodyWithIncrement.push_back(arena.make<Expression>(increment));
+        body = arena.make<Block>(bodyWithIncrement);
     }
 
     // If condition is omitted, use true
     if(condition == nullptr) {
-        condition = make_shared<LiteralExpr>(Literal(true));
+        condition = arena.make<LiteralExpr>(Value(true));
     }
     
     // Make the while loop with the condition and body
-    body = make_shared<While>(condition, body);
+    body = arena.make<While>(condition, body);
 
     // If there is an initializer, create a block with the initializer and the while loop
     if(initializer != nullptr) {
-        vector<shared_ptr<Stmt>> statements;
+        vector<Stmt*> statements;
         statements.push_back(initializer);
         statements.push_back(body);
-        body = make_shared<Block>(statements);
+        body = arena.make<Block>(statements);
     }
 
     return body;
 }
 
-shared_ptr<Stmt> Parser::printStatement() {
-    shared_ptr<Expr> value = expression();
+Stmt* Parser::forEachStatement() {
+    advance();
+    const Token& name = advance();
+    advance();
+
+    Expr* iterable = expression();
+    consume(RIGHT_PAREN, "Expect ')' after for clauses");
+    Stmt* body = statement();
+
+    return arena.make<ForEach>(name, iterable, body);
+}
+
+Stmt* Parser::printStatement() {
+    Expr* value = expression();
     consume(SEMICOLON, "Expect ';' after value.");
-    return make_shared<Print>(value);
+    return arena.make<Print>(value);
 }
 
-shared_ptr<Stmt> Parser::varDeclaration() {
-    Token name = consume(IDENTIFIER, "Expect variable name.");
-    shared_ptr<Expr> initializer = nullptr;
+Stmt* Parser::varDeclaration() {
+    const Token& name = consume(IDENTIFIER, "Expect variable name.");
+    Expr* initializer = nullptr;
     if(match({EQUAL})) {
         initializer = expression();
     }
 
     consume(SEMICOLON, "Expect ';' after variable declaration");
-    return make_shared<Var>(name, initializer);
+    return arena.make<Var>(name, initializer);
 }
 
-shared_ptr<Stmt> Parser::expressionStatement() {
-    shared_ptr<Expr> expr = expression();
+Stmt* Parser::expressionStatement() {
+    Expr* expr = expression();
     consume(SEMICOLON, "Expect ';' after expression.");
-    return make_shared<Expression>(expr);
+    return arena.make<Expression>(expr);
 }
 
-shared_ptr<Stmt> Parser::function(string kind) {
+Stmt* Parser::function(string kind) {
     // Get the function name
-    Token name = consume(IDENTIFIER, "Expect " + kind + " name.");
+    const Token& name = consume(IDENTIFIER, "Expect " + kind + " name.");
     
     // Parse parameters
     consume(LEFT_PAREN, "Expect '(' after " + kind + " name.");
-    vector<Token*> parameters;
+    vector<Token> parameters;
     if (!check(RIGHT_PAREN)) {
         do {
             if (parameters.size() >= 255) {
                 error(peek(), "Can't have more than 255 parameters.");
             }
             
-            Token* param = new Token(consume(IDENTIFIER, "Expect parameter name."));
-            parameters.push_back(param);
+            parameters.push_back(consume(IDENTIFIER, "Expect parameter name."));
         } while (match({COMMA}));
     }
     consume(RIGHT_PAREN, "Expect ')' after parameters.");
     
     // Parse the function body
     consume(LEFT_BRACE, "Expect '{' before " + kind + " body.");
-    vector<shared_ptr<Stmt>> body = block();
+    vector<Stmt*> body = block();
     
-    return make_shared<Function>(name, parameters, body);
+    return arena.make<Function>(name, parameters, body);
 }
 
-vector<shared_ptr<Stmt>> Parser::block() {
-    vector<shared_ptr<Stmt>> statements;
+vector<Stmt*> Parser::block() {
+    vector<Stmt*> statements;
 
     while(!check(RIGHT_BRACE) && !isAtEnd()) {
         statements.push_back(declaration());
@@ -172,20 +210,25 @@ vector<shared_ptr<Stmt>> Parser::block() {
     return statements;
 }
 
-shared_ptr<Expr> Parser::expression() {
+Expr* Parser::expression() {
     return assignment();
 }
 
-shared_ptr<Expr> Parser::assignment() {
-    shared_ptr<Expr> expr = logicalOr();
+Expr* Parser::assignment() {
+    Expr* expr = logicalOr();
 
     if(match({EQUAL})) {
-        Token equals = previous();
-        shared_ptr<Expr> value = assignment();
+        const Token& equals = previous();
+        Expr* value = assignment();
         //check if instance of Variable expression. if it is get the name and return a new Assign Expression with the name and value
-        if(Variable* var = dynamic_cast<Variable*>(expr.get())) {
-            Token name = var->name;
-            return make_shared<Assign>(name, value);
+        if(Variable* var = dynamic_cast<Variable*>(expr)) {
+            return arena.make<Assign>(var->name, value);
+        }
+        if(Get* get = dynamic_cast<Get*>(expr)) {
+            return arena.make<Set>(get->object, get->name, value);
+        }
+        if(Index* index = dynamic_cast<Index*>(expr)) {
+            return arena.make<IndexSet>(index->object, index->bracket, index->index, value);
         }
 
         error(equals, "Invalid assignment target.");
@@ -194,90 +237,97 @@ shared_ptr<Expr> Parser::assignment() {
     return expr;
 }
 
-shared_ptr<Expr> Parser::logicalOr() {
-    shared_ptr<Expr> expr = logicalAnd();
+Expr* Parser::logicalOr() {
+    Expr* expr = logicalAnd();
 
     while(match({OR})) {
-        Token op = previous();
-        shared_ptr<Expr> right = logicalAnd();
-        expr = make_shared<Logical>(expr, op, right);
+        const Token& op = previous();
+        Expr* right = logicalAnd();
+        expr = arena.make<Logical>(expr, op, right);
     }
 
     return expr;
 }
 
-shared_ptr<Expr> Parser::logicalAnd() {
-    shared_ptr<Expr> expr = equality();
+Expr* Parser::logicalAnd() {
+    Expr* expr = equality();
 
     while(match({AND})) {
-        Token op = previous();
-        shared_ptr<Expr> right = equality();
-        expr = make_shared<Logical>(expr, op, right);
+        const Token& op = previous();
+        Expr* right = equality();
+        expr = arena.make<Logical>(expr, op, right);
     }
 
     return expr;
 }
 
-shared_ptr<Expr> Parser::equality() {
-    shared_ptr<Expr> expr = comparison();
+Expr* Parser::equality() {
+    Expr* expr = comparison();
     while(match({BANG_EQUAL, EQUAL_EQUAL})) {
-        Token op = previous();
-        shared_ptr<Expr> right = comparison();
-        expr = make_shared<Binary>(expr, op, right);
+        const Token& op = previous();
+        Expr* right = comparison();
+        expr = arena.make<Binary>(expr, op, right);
     }
 
     return expr;
 }
 
-shared_ptr<Expr> Parser::comparison() {
-    shared_ptr<Expr> expr = term(); 
+Expr* Parser::comparison() {
+    Expr* expr = term(); 
     while(match({GREATER, GREATER_EQUAL, LESS, LESS_EQUAL})) {
-        Token op = previous();
-        shared_ptr<Expr> right = term();
-        expr = make_shared<Binary>(expr, op, right);
+        const Token& op = previous();
+        Expr* right = term();
+        expr = arena.make<Binary>(expr, op, right);
     }
 
     return expr;
 }
 
-shared_ptr<Expr> Parser::term() {
-    shared_ptr<Expr> expr = factor();
+Expr* Parser::term() {
+    Expr* expr = factor();
     while(match({MINUS, PLUS})) {
-        Token op = previous();
-        shared_ptr<Expr> right = factor();
-        expr = make_shared<Binary>(expr, op, right);
+        const Token& op = previous();
+        Expr* right = factor();
+        expr = arena.make<Binary>(expr, op, right);
     }
 
     return expr;
 }
 
-shared_ptr<Expr> Parser::factor() {
-    shared_ptr<Expr> expr = unary();
+Expr* Parser::factor() {
+    Expr* expr = unary();
     while(match({SLASH, STAR})) {
-        Token op = previous();
-        shared_ptr<Expr> right = unary();
-        expr = make_shared<Binary>(expr, op, right);
+        const Token& op = previous();
+        Expr* right = unary();
+        expr = arena.make<Binary>(expr, op, right);
     }
 
     return expr;
 }
 
-shared_ptr<Expr> Parser::unary() {
+Expr* Parser::unary() {
     if(match({BANG, MINUS})) {
-        Token op = previous();
-        shared_ptr<Expr> right = unary();
-        return make_shared<Unary>(op, right);
+        const Token& op = previous();
+        Expr* right = unary();
+        return arena.make<Unary>(op, right);
     }
 
     return call();
 }
 
-shared_ptr<Expr> Parser::call() {
-    shared_ptr<Expr> expr = primary();
+Expr* Parser::call() {
+    Expr* expr = primary();
 
     while(true) {
         if(match({LEFT_PAREN})) {
             expr = finishCall(expr);
+        } else if(match({DOT})) {
+            const Token& name = consume(IDENTIFIER, "Expect property name after '.'.");
+            expr = arena.make<Get>(expr, name);
+        } else if(match({LEFT_BRACKET})) {
+            Expr* index = expression();
+            const Token& bracket = consume(RIGHT_BRACKET, "Expect ']' after index.");
+            expr = arena.make<Index>(expr, bracket, index);
         } else {
             break;
         }
@@ -286,8 +336,8 @@ shared_ptr<Expr> Parser::call() {
     return expr;
 }
 
-shared_ptr<Expr> Parser::finishCall(shared_ptr<Expr> callee) {
-    vector<shared_ptr<Expr>> arguments;
+Expr* Parser::finishCall(Expr* callee) {
+    vector<Expr*> arguments;
     if(!check(RIGHT_PAREN)) {
         do {
             if(arguments.size() >= 255)
@@ -296,36 +346,73 @@ shared_ptr<Expr> Parser::finishCall(shared_ptr<Expr> callee) {
         } while(match({COMMA}));
     }
 
-    Token paren = consume(RIGHT_PAREN, "Expect ')' after arguments.");
+    const Token& paren = consume(RIGHT_PAREN, "Expect ')' after arguments.");
 
-    return make_shared<Call>(callee, paren, arguments);
+    Call* call = arena.make<Call>(callee, paren, arguments);
+    call->methodCallee = dynamic_cast<Get*>(callee);
+    call->superCallee = dynamic_cast<Super*>(callee);
+    return call;
 }
 
-shared_ptr<Expr> Parser::primary() {
+Expr* Parser::primary() {
     if (match({FALSE})) {
-        return make_shared<LiteralExpr>(Literal(false));
+        return arena.make<LiteralExpr>(Value(false));
     }
     if (match({TRUE})) {
-        return make_shared<LiteralExpr>(Literal(true));
+        return arena.make<LiteralExpr>(Value(true));
     }
     if (match({NIL})) {
-        return make_shared<LiteralExpr>(Literal());
+        return arena.make<LiteralExpr>(Value());
     }
-    if (match({NUMBER})) {
-        double value = stod(previous().lexeme);
-        return make_shared<LiteralExpr>(Literal(value));
+    if (match({NUMBER, STRING})) {
+        return arena.make<LiteralExpr>(previous().literal);
     }
-    if (match({STRING})) {
-        return make_shared<LiteralExpr>(Literal(previous().lexeme));
+
+    if (match({THIS})) {
+        return arena.make<This>(previous());
+    }
+    if (match({SUPER})) {
+        const Token& keyword = previous();
+        consume(DOT, "Expect '.' after 'super'.");
+        const Token& method = consume(IDENTIFIER, "Expect superclass method name.");
+        return arena.make<Super>(keyword, method);
     }
 
     if (match({LEFT_PAREN})) {
-        shared_ptr<Expr> expr = expression();
+        Expr* expr = expression();
         consume(RIGHT_PAREN, "Expect ')' after expression.");
-        return make_shared<Grouping>(expr);
+        return arena.make<Grouping>(expr);
     }
     if (match({IDENTIFIER})) {
-        return make_shared<Variable>(previous());
+        return arena.make<Variable>(previous());
+    }
+
+    if (match({LEFT_BRACKET})) {
+        const Token& bracket = previous();
+        vector<Expr*> elements;
+        if (!check(RIGHT_BRACKET)) {
+            do {
+                elements.push_back(expression());
+            } while (match({COMMA}));
+        }
+        consume(RIGHT_BRACKET, "Expect ']' after list elements.");
+        return arena.make<ListLiteral>(bracket, elements);
+    }
+    // Blocks are parsed as statements before we get here, so a brace in an
+    // expression always starts a map
+    if (match({LEFT_BRACE})) {
+        const Token& brace = previous();
+        vector<Expr*> keys;
+        vector<Expr*> values;
+        if (!check(RIGHT_BRACE)) {
+            do {
+                keys.push_back(expression());
+                consume(COLON, "Expect ':' after map key.");
+                values.push_back(expression());
+            } while (match({COMMA}));
+        }
+        consume(RIGHT_BRACE, "Expect '}' after map entries.");
+        return arena.make<MapLiteral>(brace, keys, values);
     }
     
     throw error(peek(), "Expect expression.");
@@ -347,7 +434,7 @@ bool Parser::check(TokenType type) {
     return peek().type == type;
 }
 
-Token Parser::advance() {
+const Token& Parser::advance() {
     if(!isAtEnd())
         current++;
     return previous();
@@ -357,20 +444,20 @@ bool Parser::isAtEnd() {
     return peek().type == EOF_TOKEN;
 }
 
-Token Parser::peek() {
+const Token& Parser::peek() {
     return tokens[current];
 }
 
-Token Parser::previous() {
+const Token& Parser::previous() {
     return tokens[current - 1];
 }
 
-ParseError Parser::error(Token token, string message) {
+ParseError Parser::error(const Token& token, const string& message) {
     Lox::error(token, message);
     return ParseError(message);
 }
 
-Token Parser::consume(TokenType type, string message) {
+const Token& Parser::consume(TokenType type, const string& message) {
     if (check(type)) {
         return advance();
     }
@@ -402,17 +489,17 @@ void Parser::synchronize() {
     }
 }
 
-vector<shared_ptr<Stmt>> Parser::parse() {
-    vector<shared_ptr<Stmt>> statements;
+vector<Stmt*> Parser::parse() {
+    vector<Stmt*> statements;
     while(!isAtEnd()) {
         statements.push_back(declaration());
     }
     return statements;
 }
 
-shared_ptr<Stmt> Parser::returnStatement() {
-    Token keyword = previous();
-    shared_ptr<Expr> value = nullptr;
+Stmt* Parser::returnStatement() {
+    const Token& keyword = previous();
+    Expr* value = nullptr;
     
     // Parse return value if provided
     if (!check(SEMICOLON)) {
@@ -420,5 +507,5 @@ shared_ptr<Stmt> Parser::returnStatement() {
     }
     
     consume(SEMICOLON, "Expect ';' after return value.");
-    return make_shared<Return>(keyword, value);
+    return arena.make<Return>(keyword, value);
 }
\ No newline at end of file
@@ -4,12 +4,12 @@
 #include <string>
 #include <vector>
 #include <initializer_list>
-#include <memory>
 #include <stdexcept>
 #include "Token.h"
 #include "TokenType.h"
 #include "Expr.h"
 #include "Stmt.h"
+#include "Arena.h"
 
 // Custom exception for Parser errors
 class ParseError : public std::runtime_error {
@@ -20,51 +20,54 @@ public:
 class Parser {
     private:
         int current = 0;
-        std::vector<Token> tokens;
+        const std::vector<Token>& tokens;  // Owned by the caller
+        Arena& arena;  // Owns every node the parser creates
 
         // Stmt parsing methods
-        std::shared_ptr<Stmt> declaration();
-        std::shared_ptr<Stmt> varDeclaration();
-        std::shared_ptr<Stmt> function(std::string kind);
-        std::shared_ptr<Expr> expression();
-        std::shared_ptr<Stmt> statement();
-        std::shared_ptr<Stmt> printStatement();
-        std::shared_ptr<Stmt> returnStatement();
-        std::shared_ptr<Stmt> expressionStatement();
-        std::vector<std::shared_ptr<Stmt>> block();
-        std::shared_ptr<Stmt> ifStatement();
-        std::shared_ptr<Stmt> whileStatement();
-        std::shared_ptr<Stmt> forStatement();
+        Stmt* declaration();
+        Stmt* classDeclaration();
+        Stmt* varDeclaration();
+        Stmt* function(std::string kind);
+        Expr* expression();
+        Stmt* statement();
+        Stmt* printStatement();
+        Stmt* returnStatement();
+        Stmt* expressionStatement();
+        std::vector<Stmt*> block();
+        Stmt* ifStatement();
+        Stmt* whileStatement();
+        Stmt* forStatement();
+        Stmt* forEachStatement();
 
         // Recursive descent parsing methods
-        std::shared_ptr<Expr> assignment();
-        std::shared_ptr<Expr> logicalOr();
-        std::shared_ptr<Expr> logicalAnd();
-        std::shared_ptr<Expr> equality();
-        std::shared_ptr<Expr> comparison();
-        std::shared_ptr<Expr> term();
-        std::shared_ptr<Expr> factor();
-        std::shared_ptr<Expr> unary();
-        std::shared_ptr<Expr> call();
-        std::shared_ptr<Expr> finishCall(std::shared_ptr<Expr> callee);
-        std::shared_ptr<Expr> primary();
+        Expr* assignment();
+        Expr* logicalOr();
+        Expr* logicalAnd();
+        Expr* equality();
+        Expr* comparison();
+        Expr* term();
+        Expr* factor();
+        Expr* unary();
+        Expr* call();
+        Expr* finishCall(Expr* callee);
+        Expr* primary();
 
         // Helper methods
         bool match(std::initializer_list<TokenType> types);
         bool check(TokenType type);
-        Token advance();
+        const Token& advance();
         bool isAtEnd();
-        Token peek();
-        Token previous();
+        const Token& peek();
+        const Token& previous();
         
         // Error handling
-        ParseError error(Token token, std::string message);
+        ParseError error(const Token& token, const std::string& message);
         void synchronize(); // Method to recover from errors
-        Token consume(TokenType type, std::string message);
+        const Token& consume(TokenType type, const std::string& message);
     
     public:
-        Parser(std::vector<Token>& tokens);
-        std::vector<std::shared_ptr<Stmt>> parse(); // Main parsing method
+        Parser(const std::vector<Token>& tokens, Arena& arena);
+        std::vector<Stmt*> parse(); // Main parsing method
 };
 
 #endif // PARSER_H 
\ No newline at end of file
@@ -1,11 +1,12 @@
 #include "Resolver.h"
 #include "Lox.h"
+#include <algorithm>
 
-Resolver::Resolver(Interpreter& interpreter) : interpreter(interpreter) {}
+Resolver::Resolver() {}
 
-void Resolver::resolve(const std::vector<std::shared_ptr<Stmt>>& statements) {
+void Resolver::resolve(const std::vector<Stmt*>& statements) {
     for (const auto& statement : statements) {
-        resolve(statement.get());
+        resolve(statement);
     }
 }
 
@@ -18,128 +19,320 @@ void Resolver::resolve(Expr* expr) {
 }
 
 void Resolver::beginScope() {
-    scopes.push_back(std::unordered_map<std::string, bool>());
+    scopes.push_back(Scope{static_cast<int>(scopeEnvironments.size()), functionDepth, {}, {}});
+    scopeEnvironments.push_back(false);
 }
 
-void Resolver::endScope() {
+int Resolver::endScope() {
+    Scope& scope = scopes.back();
+
+    // Captured locals get environment slots in declaration order
+    int environmentSlots = 0;
+    for (Local& local : scope.locals) {
+        bool inFrame = !local.captured;
+        int slot = inFrame ? local.frameSlot : environmentSlots++;
+        if (local.slot != nullptr) {
+            *local.slot = slot;
+            *local.inFrame = inFrame;
+        }
+
+        // Every scope in between has closed, so it is known which of them
+        // have an environment to step through
+        for (Reference& reference : local.references) {
+            int depth = 0;
+            for (int id : reference.scopesBetween) {
+                if (scopeEnvironments[id]) depth++;
+            }
+            *reference.depth = inFrame ? -1 : depth;
+            *reference.slot = slot;
+            if (reference.inFrame != nullptr) *reference.inFrame = inFrame;
+        }
+    }
+    scopeEnvironments[scope.id] = environmentSlots > 0;
+
+    // Frame slots are reused by whatever is declared after the scope closes
+    frameSlots -= scope.locals.size();
     scopes.pop_back();
+    return environmentSlots;
 }
 
-void Resolver::declare(const Token& name) {
+void Resolver::declare(const Token& name, int* slot, bool* inFrame) {
     if (scopes.empty()) return;
 
-    auto& scope = scopes.back();
-    if (scope.find(name.lexeme) != scope.end()) {
+    Scope& scope = scopes.back();
+    if (scope.names.find(name.lexeme) != scope.names.end()) {
         Lox::error(name, "Already a variable with this name in this scope.");
     }
 
-    // Mark it as "not ready yet"
-    scope[name.lexeme] = false;
+    // Frame slots are handed out in declaration order, which is also the
+    // order the interpreter defines them at runtime. Mark it as "not ready yet"
+    Local local;
+    local.frameSlot = frameSlots++;
+    local.slot = slot;
+    local.inFrame = inFrame;
+    frameSize = std::max(frameSize, frameSlots);
+    scope.names[name.lexeme] = scope.locals.size();
+    scope.locals.push_back(std::move(local));
 }
 
 void Resolver::define(const Token& name) {
     if (scopes.empty()) return;
     // Mark it as fully initialized and ready for use
-    scopes.back()[name.lexeme] = true;
+    Scope& scope = scopes.back();
+    scope.locals[scope.names[name.lexeme]].defined = true;
 }
 
-void Resolver::resolveLocal(Expr* expr, const Token& name) {
+void Resolver::resolveLocal(const Token& name, int* depth, int* slot, bool* inFrame) {
     for (int i = scopes.size() - 1; i >= 0; i--) {
-        if (scopes[i].find(name.lexeme) != scopes[i].end()) {
-            // Tell the interpreter at which scope level we found the variable
-            interpreter.resolve(expr, scopes.size() - 1 - i);
+        auto it = scopes[i].names.find(name.lexeme);
+        if (it != scopes[i].names.end()) {
+            Local& local = scopes[i].locals[it->second];
+            // A closure reaching out of its own function captures the local
+            if (scopes.back().function > scopes[i].function) local.captured = true;
+
+            Reference reference{depth, slot, inFrame, {}};
+            for (size_t j = i + 1; j < scopes.size(); j++) {
+                reference.scopesBetween.push_back(scopes[j].id);
+            }
+            local.references.push_back(std::move(reference));
             return;
         }
     }
+
+    // Not found in any local scope, so it is a global
+    *depth = -1;
+    *slot = -1;
+    if (inFrame != nullptr) *inFrame = false;
 }
 
 // Statement visitors
 void Resolver::visitBlock(Block* stmt) {
     beginScope();
     for (const auto& statement : stmt->statements) {
-        resolve(statement.get());
+        resolve(statement);
     }
-    endScope();
+    stmt->slotCount = endScope();
 }
 
 void Resolver::visitExpression(Expression* stmt) {
-    resolve(stmt->expression.get());
+    resolve(stmt->expression);
+}
+
+void Resolver::visitForEach(ForEach* stmt) {
+    resolve(stmt->iterable);
+
+    // The loop variable is the only local in its scope, so if it is
+    // captured it is in slot zero of an environment made for each pass
+    beginScope();
+    declare(stmt->name, &stmt->slot, &stmt->inFrame);
+    define(stmt->name);
+    resolve(stmt->body);
+    endScope();
 }
 
 void Resolver::visitFunction(Function* stmt) {
     // Define the function name in the current scope
-    declare(stmt->name);
+    declare(stmt->name, &stmt->slot, &stmt->inFrame);
     define(stmt->name);
 
+    resolveFunction(stmt, FunctionType::FUNCTION);
+}
+
+void Resolver::resolveFunction(Function* function, FunctionType type) {
+    FunctionType enclosingFunction = currentFunction;
+    currentFunction = type;
+
+    // The function gets a frame of its own
+    int enclosingFrameSlots = frameSlots;
+    int enclosingFrameSize = frameSize;
+    functionDepth++;
+    frameSlots = 0;
+    frameSize = 0;
+
     // Create a new scope for the function body
     beginScope();
     
     // Define all parameters in the function scope
-    for (Token* param : stmt->params) {
-        declare(*param);
-        define(*param);
+    for (const Token& param : function->params) {
+        declare(param);
+        define(param);
+    }
+
+    // Methods get the receiver in the slot after the parameters
+    if (function->isMethod) {
+        Token self(THIS, "this", Value(), function->name.line);
+        declare(self);
+        define(self);
     }
     
     // Resolve the function body statements individually
-    for (const auto& statement : stmt->body) {
-        resolve(statement.get());
+    for (const auto& statement : function->body) {
+        resolve(statement);
     }
-    
-    endScope();
+    function->frameSize = frameSize;
+
+    // Parameters (and "this") arrive in the frame, and the captured ones
+    // are copied into the environment's first slots
+    size_t received = function->params.size() + (function->isMethod ? 1 : 0);
+    function->capturedParams.clear();
+    for (size_t i = 0; i < received; i++) {
+        if (scopes.back().locals[i].captured) function->capturedParams.push_back(i);
+    }
+    function->slotCount = endScope();
+
+    currentFunction = enclosingFunction;
+    functionDepth--;
+    frameSlots = enclosingFrameSlots;
+    frameSize = enclosingFrameSize;
+}
+
+void Resolver::visitClass(Class* stmt) {
+    ClassType enclosingClass = currentClass;
+    currentClass = ClassType::CLASS;
+
+    declare(stmt->name, &stmt->slot, &stmt->inFrame);
+    define(stmt->name);
+
+    if (stmt->superclass != nullptr) {
+        if (stmt->superclass->name.lexeme == stmt->name.lexeme) {
+            Lox::error(stmt->superclass->name, "A class can't inherit from itself.");
+        }
+        currentClass = ClassType::SUBCLASS;
+        resolve(stmt->superclass);
+
+        // "super" gets a scope of its own between the methods and the class.
+        // The Interpreter always gives it an environment, so it counts as
+        // captured even if no method uses it.
+        beginScope();
+        Token super(SUPER, "super", Value(), stmt->name.line);
+        declare(super);
+        define(super);
+        scopes.back().locals.back().captured = true;
+    }
+
+    for (Function* method : stmt->methods) {
+        resolveFunction(method, method->isInitializer() ? FunctionType::INITIALIZER : FunctionType::METHOD);
+    }
+
+    if (stmt->superclass != nullptr) endScope();
+    currentClass = enclosingClass;
 }
 
 void Resolver::visitIf(If* stmt) {
-    resolve(stmt->condition.get());
-    resolve(stmt->thenBranch.get());
+    resolve(stmt->condition);
+    resolve(stmt->thenBranch);
     if (stmt->elseBranch != nullptr) {
-        resolve(stmt->elseBranch.get());
+        resolve(stmt->elseBranch);
     }
 }
 
 void Resolver::visitPrint(Print* stmt) {
-    resolve(stmt->expression.get());
+    resolve(stmt->expression);
 }
 
 void Resolver::visitReturn(Return* stmt) {
     if (stmt->value != nullptr) {
-        resolve(stmt->value.get());
+        if (currentFunction == FunctionType::INITIALIZER) {
+            Lox::error(stmt->keyword, "Can't return a value from an initializer.");
+        }
+        resolve(stmt->value);
+
+        // A top-level return has no frame to reuse
+        if (currentFunction == FunctionType::FUNCTION || currentFunction == FunctionType::METHOD) {
+            stmt->tailCall = dynamic_cast<Call*>(stmt->value);
+        }
     }
 }
 
 void Resolver::visitVar(Var* stmt) {
-    declare(stmt->name);
+    declare(stmt->name, &stmt->slot, &stmt->inFrame);
     if (stmt->initializer != nullptr) {
-        resolve(stmt->initializer.get());
+        resolve(stmt->initializer);
     }
     define(stmt->name);
 }
 
 void Resolver::visitWhile(While* stmt) {
-    resolve(stmt->condition.get());
-    resolve(stmt->body.get());
+    resolve(stmt->condition);
+    resolve(stmt->body);
 }
 
 // Expression visitors
 void Resolver::visitAssign(Assign* expr) {
-    resolve(expr->value.get());
-    resolveLocal(expr, expr->name);
+    resolve(expr->value);
+    resolveLocal(expr->name, &expr->depth, &expr->slot, &expr->inFrame);
 }
 
 void Resolver::visitBinary(Binary* expr) {
-    resolve(expr->left.get());
-    resolve(expr->right.get());
+    resolve(expr->left);
+    resolve(expr->right);
 }
 
 void Resolver::visitCall(Call* expr) {
-    resolve(expr->callee.get());
+    resolve(expr->callee);
 
     for (const auto& argument : expr->arguments) {
-        resolve(argument.get());
+        resolve(argument);
     }
 }
 
+void Resolver::visitGet(Get* expr) {
+    resolve(expr->object);
+}
+
+void Resolver::visitIndex(Index* expr) {
+    resolve(expr->object);
+    resolve(expr->index);
+}
+
+void Resolver::visitIndexSet(IndexSet* expr) {
+    resolve(expr->object);
+    resolve(expr->index);
+    resolve(expr->value);
+}
+
+void Resolver::visitListLiteral(ListLiteral* expr) {
+    for (Expr* element : expr->elements) {
+        resolve(element);
+    }
+}
+
+void Resolver::visitMapLiteral(MapLiteral* expr) {
+    for (size_t i = 0; i < expr->keys.size(); i++) {
+        resolve(expr->keys[i]);
+        resolve(expr->values[i]);
+    }
+}
+
+void Resolver::visitSet(Set* expr) {
+    resolve(expr->value);
+    resolve(expr->object);
+}
+
+void Resolver::visitSuper(Super* expr) {
+    if (currentClass == ClassType::NONE) {
+        Lox::error(expr->keyword, "Can't use 'super' outside of a class.");
+    } else if (currentClass != ClassType::SUBCLASS) {
+        Lox::error(expr->keyword, "Can't use 'super' in a class with no superclass.");
+    }
+
+    // "super" is never in a frame
+    resolveLocal(expr->keyword, &expr->depth, &expr->slot, nullptr);
+    Token self(THIS, "this", Value(), expr->keyword.line);
+    resolveLocal(self, &expr->thisDepth, &expr->thisSlot, &expr->thisInFrame);
+}
+
+void Resolver::visitThis(This* expr) {
+    if (currentClass == ClassType::NONE) {
+        Lox::error(expr->keyword, "Can't use 'this' outside of a class.");
+        return;
+    }
+
+    resolveLocal(expr->keyword, &expr->depth, &expr->slot, &expr->inFrame);
+}
+
 void Resolver::visitGrouping(Grouping* expr) {
-    resolve(expr->expression.get());
+    resolve(expr->expression);
 }
 
 void Resolver::visitLiteralExpr(LiteralExpr* expr) {
@@ -147,22 +340,22 @@ void Resolver::visitLiteralExpr(LiteralExpr* expr) {
 }
 
 void Resolver::visitLogical(Logical* expr) {
-    resolve(expr->left.get());
-    resolve(expr->right.get());
+    resolve(expr->left);
+    resolve(expr->right);
 }
 
 void Resolver::visitUnary(Unary* expr) {
-    resolve(expr->right.get());
+    resolve(expr->right);
 }
 
 void Resolver::visitVariable(Variable* expr) {
     if (!scopes.empty()) {
-        auto& scope = scopes.back();
-        auto it = scope.find(expr->name.lexeme);
-        if (it != scope.end() && it->second == false) {
+        Scope& scope = scopes.back();
+        auto it = scope.names.find(expr->name.lexeme);
+        if (it != scope.names.end() && !scope.locals[it->second].defined) {
             Lox::error(expr->name, "Can't read local variable in its own initializer.");
         }
     }
 
-    resolveLocal(expr, expr->name);
+    resolveLocal(expr->name, &expr->depth, &expr->slot, &expr->inFrame);
 }
\ No newline at end of file
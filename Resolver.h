@@ -1,21 +1,65 @@
 #include "Expr.h"
-#include "Interpreter.h"
 #include "Stmt.h"
 #include <vector>
 #include <unordered_map>
 #include <string>
+#include <string_view>
 
 class Resolver : public VoidExprVisitor, public StmtVisitor<void> {
     private:
-        Interpreter& interpreter;
-        std::vector<std::unordered_map<std::string, bool>> scopes;
+        // Where a local lives is only known once its scope closes: a local
+        // that some inner function refers to is captured and goes in the
+        // scope's environment, anything else stays in the frame of the call
+        // (or of the top-level script). Until then every node that names
+        // the local is remembered so it can be filled in.
+        struct Reference {
+            int* depth;
+            int* slot;
+            bool* inFrame;
+            std::vector<int> scopesBetween;  // Ids of the scopes crossed to reach the local
+        };
+
+        struct Local {
+            int frameSlot;
+            bool defined = false;   // Whether its initializer has finished resolving
+            bool captured = false;
+            int* slot = nullptr;    // The declaring statement's, if it has one
+            bool* inFrame = nullptr;
+            std::vector<Reference> references;
+        };
+
+        struct Scope {
+            int id;
+            int function;  // How many functions deep the scope is
+            std::unordered_map<std::string_view, size_t> names;
+            std::vector<Local> locals;  // In declaration order
+        };
+
+        std::vector<Scope> scopes;
+        // Whether each scope, by id, turned out to need an environment
+        std::vector<bool> scopeEnvironments;
+        int functionDepth = 0;
+
+        // Frame slots of the function being resolved: how many are in use
+        // by the scopes still open, and the most ever in use at once
+        int frameSlots = 0;
+        int frameSize = 0;
+
+        // What kind of code is being resolved, for the checks on return,
+        // this and super
+        enum class FunctionType { NONE, FUNCTION, METHOD, INITIALIZER };
+        enum class ClassType { NONE, CLASS, SUBCLASS };
+        FunctionType currentFunction = FunctionType::NONE;
+        ClassType currentClass = ClassType::NONE;
 
     public:
-        Resolver(Interpreter& interpreter);
+        Resolver();
         
         // Statement visitors
         void visitBlock(Block* stmt) override;
+        void visitClass(Class* stmt) override;
         void visitExpression(Expression* stmt) override;
+        void visitForEach(ForEach* stmt) override;
         void visitFunction(Function* stmt) override;
         void visitIf(If* stmt) override;
         void visitPrint(Print* stmt) override;
@@ -27,20 +71,35 @@ class Resolver : public VoidExprVisitor, public StmtVisitor<void> {
         void visitAssign(Assign* expr) override;
         void visitBinary(Binary* expr) override;
         void visitCall(Call* expr) override;
+        void visitGet(Get* expr) override;
         void visitGrouping(Grouping* expr) override;
+        void visitIndex(Index* expr) override;
+        void visitIndexSet(IndexSet* expr) override;
+        void visitListLiteral(ListLiteral* expr) override;
         void visitLiteralExpr(LiteralExpr* expr) override;
         void visitLogical(Logical* expr) override;
+        void visitMapLiteral(MapLiteral* expr) override;
+        void visitSet(Set* expr) override;
+        void visitSuper(Super* expr) override;
+        void visitThis(This* expr) override;
         void visitUnary(Unary* expr) override;
         void visitVariable(Variable* expr) override;
 
-        void resolve(const std::vector<std::shared_ptr<Stmt>>& statements);
+        void resolve(const std::vector<Stmt*>& statements);
+        // Frame slots the top-level code needs for the locals of its blocks
+        int scriptFrameSize() const { return frameSize; }
         void resolve(Stmt* stmt);
         void resolve(Expr* expr);
 
     private:
         void beginScope();
-        void endScope();
-        void declare(const Token& name);
+        // Places the scope's locals, returning how many went in its
+        // environment. Zero means the scope needs no environment at all.
+        int endScope();
+        // The declaring statement's slot and inFrame are filled in when the
+        // scope closes
+        void declare(const Token& name, int* slot = nullptr, bool* inFrame = nullptr);
         void define(const Token& name);
-        void resolveLocal(Expr* expr, const Token& name);
+        void resolveLocal(const Token& name, int* depth, int* slot, bool* inFrame);
+        void resolveFunction(Function* function, FunctionType type);
 };
\ No newline at end of file
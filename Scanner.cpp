@@ -1,8 +1,10 @@
 #include "Scanner.h"
 #include "Lox.h"
+#include "Heap.h"
+#include <charconv>
 using namespace std;
 
-const unordered_map<string, TokenType> Scanner::keywords = {
+const unordered_map<string_view, TokenType> Scanner::keywords = {
     {"and",    AND},
     {"class",  CLASS},
     {"else",   ELSE},
@@ -21,8 +23,9 @@ const unordered_map<string, TokenType> Scanner::keywords = {
     {"while",  WHILE}
 };
 
-Scanner::Scanner(string source) {
-    this->source = source;
+Scanner::Scanner(string_view source, PinnedValues& literals) : source(source), literals(literals) {
+    // Roughly one token per five characters of typical code
+    tokens.reserve(source.size() / 5 + 1);
 }
 
 bool Scanner::isAtEnd() {
@@ -34,8 +37,8 @@ vector<Token> Scanner::scanTokens() {
         start = current;
         scanToken();
     }
-    tokens.push_back(Token(EOF_TOKEN, "", Literal(), line));
-    return tokens;
+    tokens.emplace_back(EOF_TOKEN, "", Value(), line);
+    return std::move(tokens);
 }
 
 void Scanner::scanToken() {
@@ -45,6 +48,9 @@ void Scanner::scanToken() {
         case ')': addToken(RIGHT_PAREN); break;
         case '{': addToken(LEFT_BRACE); break;
         case '}': addToken(RIGHT_BRACE); break;
+        case '[': addToken(LEFT_BRACKET); break;
+        case ']': addToken(RIGHT_BRACKET); break;
+        case ':': addToken(COLON); break;
         case ',': addToken(COMMA); break;
         case '.': addToken(DOT); break;
         case '-': addToken(MINUS); break;
@@ -96,12 +102,11 @@ char Scanner::advance() {
 }
 
 void Scanner::addToken(TokenType type) {
-    addToken(type, Literal());
+    addToken(type, Value());
 }
 
-void Scanner::addToken(TokenType type, Literal literal) {
-    string text = source.substr(start, current - start);
-    tokens.push_back(Token(type, text, literal, line));
+void Scanner::addToken(TokenType type, const Value& literal) {
+    tokens.emplace_back(type, source.substr(start, current - start), literal, line);
 } 
 
 bool Scanner::match(char expected) {
@@ -152,8 +157,8 @@ void Scanner::handleString() {
 
     advance(); // closing ".
 
-    string value = source.substr(start + 1, current - start - 2);
-    addToken(STRING, Literal(value));
+    string_view value = source.substr(start + 1, current - start - 2);
+    addToken(STRING, literals.add(Value(Heap::instance().intern(value))));
 }
 
 void Scanner::handleNumber() {
@@ -166,18 +171,15 @@ void Scanner::handleNumber() {
             advance();
     }
 
-    string numberStr = source.substr(start, current - start);
-    double value = stod(numberStr);
-    addToken(NUMBER, Literal(value));
+    double value = 0;
+    from_chars(source.data() + start, source.data() + current, value);
+    addToken(NUMBER, Value(value));
 }
 
 void Scanner::handleIdentifier() {
     while(isAlphaNumeric(peek()))
         advance();
 
-    string text = source.substr(start, current - start);
-    TokenType type = IDENTIFIER;
-    if(keywords.count(text) > 0)
-        type = keywords.at(text);
-    addToken(type);
+    auto keyword = keywords.find(source.substr(start, current - start));
+    addToken(keyword != keywords.end() ? keyword->second : IDENTIFIER);
 }
\ No newline at end of file
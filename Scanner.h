@@ -2,15 +2,21 @@
 #define SCANNER_H
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <unordered_map>
 #include "Token.h"
-#include "Literal.h"
 
+class PinnedValues;
+
+// Splits source into tokens without copying it: lexemes are views into
+// source, so the buffer must outlive the tokens and the tree built from them.
+// String literals are interned as they are scanned and pinned in literals.
 class Scanner {
 private:
-    static const std::unordered_map<std::string, TokenType> keywords;
-    std::string source;
+    static const std::unordered_map<std::string_view, TokenType> keywords;
+    std::string_view source;
+    PinnedValues& literals;
     std::vector<Token> tokens;
     size_t start = 0;
     size_t current = 0;
@@ -20,7 +26,7 @@ private:
     char advance();
     void scanToken();
     void addToken(TokenType type);
-    void addToken(TokenType type, Literal literal);
+    void addToken(TokenType type, const Value& literal);
     bool match(char expected);
     char peek();
     char peekNext();
@@ -32,7 +38,7 @@ private:
     bool isAlphaNumeric(char c);
 
 public:
-    Scanner(std::string source);
+    Scanner(std::string_view source, PinnedValues& literals);
     std::vector<Token> scanTokens();
 };
 
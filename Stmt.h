@@ -1,19 +1,17 @@
 #ifndef Stmt_H
 #define Stmt_H
 
-#include <memory>
 #include <vector>
 #include <string>
 #include "Token.h"
-#include "Literal.h"
 #include "Value.h"
 #include "Expr.h"
 
-using std::shared_ptr;
-
 class Block;
+class Class;
 class If;
 class Expression;
+class ForEach;
 class Function;
 class Return;
 class Var;
@@ -26,8 +24,10 @@ class StmtVisitor {
 public:
     virtual ~StmtVisitor() = default;
     virtual R visitBlock(Block* stmt) = 0;
+    virtual R visitClass(Class* stmt) = 0;
     virtual R visitIf(If* stmt) = 0;
     virtual R visitExpression(Expression* stmt) = 0;
+    virtual R visitForEach(ForEach* stmt) = 0;
     virtual R visitFunction(Function* stmt) = 0;
     virtual R visitReturn(Return* stmt) = 0;
     virtual R visitVar(Var* stmt) = 0;
@@ -35,21 +35,32 @@ public:
     virtual R visitWhile(While* stmt) = 0;
 };
 
+// How a statement finished executing. Anything other than NORMAL unwinds
+// the enclosing statements until something handles it (a call for RETURN).
+enum class ExecStatus {
+    NORMAL,
+    RETURN,
+    TAIL_CALL  // Returning the result of a call the Interpreter has set up, to run in the caller's frame
+};
+
 // Convenience type aliases for common visitor types
 using StmtStringVisitor = StmtVisitor<std::string>;
 using VoidVisitor = StmtVisitor<void>;
+using ExecVisitor = StmtVisitor<ExecStatus>;
 
-// Base statement class
+// Base statement class. Like expressions, statements are allocated in the
+// Parser's Arena and child pointers do not own anything.
 class Stmt {
 public:
     virtual ~Stmt() = default;
     virtual std::string accept(StmtStringVisitor& visitor) = 0;
     virtual void accept(VoidVisitor& visitor) = 0;
+    virtual ExecStatus accept(ExecVisitor& visitor) = 0;
 };
 
 class Block : public Stmt {
 public:
-    Block(const std::vector<shared_ptr<Stmt>>& statements) : statements(statements) {}
+    Block(const std::vector<Stmt*>& statements) : statements(statements) {}
 
     std::string accept(StmtStringVisitor& visitor) override {
         return visitor.visitBlock(this);
@@ -59,13 +70,48 @@ public:
         visitor.visitBlock(this);
     }
 
+    ExecStatus accept(ExecVisitor& visitor) override {
+        return visitor.visitBlock(this);
+    }
+
+    // Fields
+    std::vector<Stmt*> statements;
+
+    // Number of locals declared directly in this block that closures
+    // capture, set by the Resolver. A block without any gets no environment;
+    // its other locals live in the frame.
+    int slotCount = 0;
+};
+
+class Class : public Stmt {
+public:
+    Class(const Token& name, Variable* superclass, const std::vector<Function*>& methods) : name(name), superclass(superclass), methods(methods) {}
+
+    std::string accept(StmtStringVisitor& visitor) override {
+        return visitor.visitClass(this);
+    }
+
+    void accept(VoidVisitor& visitor) override {
+        visitor.visitClass(this);
+    }
+
+    ExecStatus accept(ExecVisitor& visitor) override {
+        return visitor.visitClass(this);
+    }
+
     // Fields
-    std::vector<shared_ptr<Stmt>> statements;
+    Token name;
+    Variable* superclass;  // nullptr when the class has none
+    std::vector<Function*> methods;
+
+    // Slot assigned by the Resolver; -1 means the class is global
+    int slot = -1;
+    bool inFrame = false;  // The slot is in the frame, not an environment
 };
 
 class If : public Stmt {
 public:
-    If(const shared_ptr<Expr>& condition, const shared_ptr<Stmt>& thenBranch, const shared_ptr<Stmt>& elseBranch) : condition(condition), thenBranch(thenBranch), elseBranch(elseBranch) {}
+    If(Expr* condition, Stmt* thenBranch, Stmt* elseBranch) : condition(condition), thenBranch(thenBranch), elseBranch(elseBranch) {}
 
     std::string accept(StmtStringVisitor& visitor) override {
         return visitor.visitIf(this);
@@ -75,15 +121,19 @@ public:
         visitor.visitIf(this);
     }
 
+    ExecStatus accept(ExecVisitor& visitor) override {
+        return visitor.visitIf(this);
+    }
+
     // Fields
-    shared_ptr<Expr> condition;
-    shared_ptr<Stmt> thenBranch;
-    shared_ptr<Stmt> elseBranch;
+    Expr* condition;
+    Stmt* thenBranch;
+    Stmt* elseBranch;
 };
 
 class Expression : public Stmt {
 public:
-    Expression(const shared_ptr<Expr>& expression) : expression(expression) {}
+    Expression(Expr* expression) : expression(expression) {}
 
     std::string accept(StmtStringVisitor& visitor) override {
         return visitor.visitExpression(this);
@@ -93,13 +143,46 @@ public:
         visitor.visitExpression(this);
     }
 
+    ExecStatus accept(ExecVisitor& visitor) override {
+        return visitor.visitExpression(this);
+    }
+
+    // Fields
+    Expr* expression;
+};
+
+// for (var name : iterable) body. The loop variable gets a scope of its own,
+// created afresh for every element so closures capture that element.
+class ForEach : public Stmt {
+public:
+    ForEach(const Token& name, Expr* iterable, Stmt* body) : name(name), iterable(iterable), body(body) {}
+
+    std::string accept(StmtStringVisitor& visitor) override {
+        return visitor.visitForEach(this);
+    }
+
+    void accept(VoidVisitor& visitor) override {
+        visitor.visitForEach(this);
+    }
+
+    ExecStatus accept(ExecVisitor& visitor) override {
+        return visitor.visitForEach(this);
+    }
+
     // Fields
-    shared_ptr<Expr> expression;
+    Token name;
+    Expr* iterable;
+    Stmt* body;
+
+    // Where the Resolver put the loop variable: a frame slot, or, when a
+    // closure captures it, slot zero of an environment created for each pass
+    int slot = 0;
+    bool inFrame = false;
 };
 
 class Function : public Stmt {
 public:
-    Function(const Token& name, const std::vector<Token*>& params, const std::vector<shared_ptr<Stmt>>& body) : name(name), params(params), body(body) {}
+    Function(const Token& name, const std::vector<Token>& params, const std::vector<Stmt*>& body) : name(name), params(params), body(body) {}
 
     std::string accept(StmtStringVisitor& visitor) override {
         return visitor.visitFunction(this);
@@ -109,15 +192,39 @@ public:
         visitor.visitFunction(this);
     }
 
+    ExecStatus accept(ExecVisitor& visitor) override {
+        return visitor.visitFunction(this);
+    }
+
     // Fields
     Token name;
-    std::vector<Token*> params;
-    std::vector<shared_ptr<Stmt>> body;
+    std::vector<Token> params;
+    std::vector<Stmt*> body;
+
+    // Set by the Parser for methods, which receive "this" in the slot after
+    // their parameters
+    bool isMethod = false;
+
+    // Set by the Resolver: the slot the function's name is bound to (-1 when
+    // global) and whether that slot is in a frame
+    int slot = -1;
+    bool inFrame = false;
+
+    // Also set by the Resolver. A call's locals live in a frame of frameSize
+    // slots on the Interpreter's value stack, starting with the arguments.
+    // Locals that closures capture live in an environment of slotCount
+    // slots instead (none if zero); capturedParams lists the frame slots of
+    // the parameters, and "this", to copy into its first slots.
+    int frameSize = 0;
+    int slotCount = 0;
+    std::vector<int> capturedParams;
+
+    bool isInitializer() const { return isMethod && name.lexeme == "init"; }
 };
 
 class Return : public Stmt {
 public:
-    Return(const Token& keyword, const shared_ptr<Expr>& value) : keyword(keyword), value(value) {}
+    Return(const Token& keyword, Expr* value) : keyword(keyword), value(value) {}
 
     std::string accept(StmtStringVisitor& visitor) override {
         return visitor.visitReturn(this);
@@ -127,14 +234,22 @@ public:
         visitor.visitReturn(this);
     }
 
+    ExecStatus accept(ExecVisitor& visitor) override {
+        return visitor.visitReturn(this);
+    }
+
     // Fields
     Token keyword;
-    shared_ptr<Expr> value;
+    Expr* value;
+
+    // Set by the Resolver when value is a call in tail position: its result
+    // is returned as is, so it can take over the returning call's frame
+    Call* tailCall = nullptr;
 };
 
 class Var : public Stmt {
 public:
-    Var(const Token& name, const shared_ptr<Expr>& initializer) : name(name), initializer(initializer) {}
+    Var(const Token& name, Expr* initializer) : name(name), initializer(initializer) {}
 
     std::string accept(StmtStringVisitor& visitor) override {
         return visitor.visitVar(this);
@@ -144,14 +259,22 @@ public:
         visitor.visitVar(this);
     }
 
+    ExecStatus accept(ExecVisitor& visitor) override {
+        return visitor.visitVar(this);
+    }
+
     // Fields
     Token name;
-    shared_ptr<Expr> initializer;
+    Expr* initializer;
+
+    // Slot assigned by the Resolver; -1 means the variable is global
+    int slot = -1;
+    bool inFrame = false;  // The slot is in the frame, not an environment
 };
 
 class Print : public Stmt {
 public:
-    Print(const shared_ptr<Expr>& expression) : expression(expression) {}
+    Print(Expr* expression) : expression(expression) {}
 
     std::string accept(StmtStringVisitor& visitor) override {
         return visitor.visitPrint(this);
@@ -161,13 +284,17 @@ public:
         visitor.visitPrint(this);
     }
 
+    ExecStatus accept(ExecVisitor& visitor) override {
+        return visitor.visitPrint(this);
+    }
+
     // Fields
-    shared_ptr<Expr> expression;
+    Expr* expression;
 };
 
 class While : public Stmt {
 public:
-    While(const shared_ptr<Expr>& condition, const shared_ptr<Stmt>& body) : condition(condition), body(body) {}
+    While(Expr* condition, Stmt* body) : condition(condition), body(body) {}
 
     std::string accept(StmtStringVisitor& visitor) override {
         return visitor.visitWhile(this);
@@ -177,9 +304,13 @@ public:
         visitor.visitWhile(this);
     }
 
+    ExecStatus accept(ExecVisitor& visitor) override {
+        return visitor.visitWhile(this);
+    }
+
     // Fields
-    shared_ptr<Expr> condition;
-    shared_ptr<Stmt> body;
+    Expr* condition;
+    Stmt* body;
 };
 
 #endif // Stmt_H
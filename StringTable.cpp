@@ -0,0 +1,53 @@
+#include "StringTable.h"
+
+using namespace std;
+
+// Marks a removed entry so probe sequences running through it continue
+static ObjString* const TOMBSTONE = reinterpret_cast<ObjString*>(uintptr_t(1));
+
+static bool isLive(const ObjString* entry) {
+    return entry != nullptr && entry != TOMBSTONE;
+}
+
+ObjString* StringTable::find(string_view chars, uint32_t hash) const {
+    if (entries.empty()) return nullptr;
+
+    size_t mask = entries.size() - 1;
+    for (size_t index = hash & mask;; index = (index + 1) & mask) {
+        ObjString* entry = entries[index];
+        if (entry == nullptr) return nullptr;
+        if (entry != TOMBSTONE && entry->hash == hash && entry->chars == chars) {
+            return entry;
+        }
+    }
+}
+
+void StringTable::insert(ObjString* string) {
+    // Keep the load factor, tombstones included, under 3/4
+    if ((count + 1) * 4 > entries.size() * 3) grow();
+
+    size_t mask = entries.size() - 1;
+    size_t index = string->hash & mask;
+    while (isLive(entries[index])) {
+        index = (index + 1) & mask;
+    }
+    if (entries[index] == nullptr) count++;
+    entries[index] = string;
+}
+
+void StringTable::removeUnmarked() {
+    for (ObjString*& entry : entries) {
+        if (isLive(entry) && !entry->marked) entry = TOMBSTONE;
+    }
+}
+
+void StringTable::grow() {
+    vector<ObjString*> old = std::move(entries);
+    entries.assign(old.empty() ? 8 : old.size() * 2, nullptr);
+    count = 0;
+
+    // Tombstones are dropped along the way
+    for (ObjString* entry : old) {
+        if (isLive(entry)) insert(entry);
+    }
+}
@@ -0,0 +1,26 @@
+#ifndef STRING_TABLE_H
+#define STRING_TABLE_H
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+#include "Object.h"
+
+// Set of every interned string, keyed by contents. Open addressing with
+// linear probing; lookups compare the cached hash before the characters.
+// The table does not keep strings alive: the Heap drops unmarked entries
+// before it sweeps.
+class StringTable {
+public:
+    ObjString* find(std::string_view chars, uint32_t hash) const;
+    void insert(ObjString* string);
+    void removeUnmarked();
+
+private:
+    std::vector<ObjString*> entries;  // Capacity is always a power of two
+    size_t count = 0;                 // Live entries plus tombstones
+
+    void grow();
+};
+
+#endif // STRING_TABLE_H
@@ -1,16 +1,12 @@
 #include "Token.h"
 using namespace std;
 
-Token::Token(TokenType type, string lexeme, Literal literal, int line) {
-    this->type = type;
-    this->lexeme = lexeme;
-    this->literal = literal;
-    this->line = line;
-}
+Token::Token(TokenType type, string_view lexeme, Value literal, int line)
+    : type(type), lexeme(lexeme), literal(literal), line(line) {}
 
 string Token::toString() const {
     string literalStr = literal.toString();
-    return string(TOKEN_NAMES[type]) + " " + lexeme + " " + literalStr;
+    return string(TOKEN_NAMES[type]) + " " + string(lexeme) + " " + literalStr;
 }
 
 ostream& operator<<(ostream& os, const Token& token) {
@@ -2,18 +2,21 @@
 #define TOKEN_H
 
 #include <string>
+#include <string_view>
 #include <ostream>
 #include "TokenType.h"
-#include "Literal.h"
+#include "Value.h"
 
+// A token's lexeme is a view into the source buffer it was scanned from,
+// which must outlive every token and syntax tree node built from it
 class Token {
 public:
     TokenType type;
-    std::string lexeme;
-    Literal literal;
+    std::string_view lexeme;
+    Value literal;  // Numbers and interned strings; nil for everything else
     int line;
 
-    Token(TokenType type, std::string lexeme, Literal literal, int line);
+    Token(TokenType type, std::string_view lexeme, Value literal, int line);
     std::string toString() const;
     friend std::ostream& operator<<(std::ostream& os, const Token& token);
 };
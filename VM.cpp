@@ -0,0 +1,688 @@
+#include "VM.h"
+#include "Interpreter.h" // For RuntimeError
+#include "LoxClass.h"
+#include "LoxCollections.h"
+#include "LoxBuiltinFunctions.h"
+#include "Output.h"
+#include <algorithm>
+
+using namespace std;
+
+// Computed goto jumps straight from one handler to the next instead of going
+// back through a switch, which keeps the branch predictor happy
+#if defined(__GNUC__)
+#define USE_COMPUTED_GOTO 1
+#else
+#define USE_COMPUTED_GOTO 0
+#endif
+
+VM::VM(size_t maxCallDepth)
+    : heap(Heap::instance()), maxFrames(maxCallDepth + 1), stack(new Value[INITIAL_STACK_SLOTS]) {
+    stackEnd = stack.get() + INITIAL_STACK_SLOTS;
+    frames.reserve(maxFrames);
+    resetStack();
+    heap.addRootSource(this);
+
+    // Define built-in functions
+    defineBuiltinFunctions([this](string_view name, const Value& function) {
+        int slot = globalSlot(string(name));
+        globalValues[slot] = function;
+        globalDefined[slot] = true;
+    });
+}
+
+VM::~VM() {
+    heap.removeRootSource(this);
+}
+
+void VM::markRoots(Heap& heap) {
+    // Every frame's closure sits in its first stack slot
+    for (Value* slot = stack.get(); slot < stackTop; slot++) {
+        heap.markValue(*slot);
+    }
+    for (const Value& value : globalValues) {
+        heap.markValue(value);
+    }
+    for (VmUpvalue* upvalue : openUpvalues) {
+        heap.markObject(upvalue);
+    }
+}
+
+int VM::globalSlot(const string& name) {
+    auto it = globalIndices.find(name);
+    if (it != globalIndices.end()) {
+        return it->second;
+    }
+
+    int index = globalNames.size();
+    globalIndices[name] = index;
+    globalNames.push_back(name);
+    globalValues.emplace_back();
+    globalDefined.push_back(false);
+    return index;
+}
+
+void VM::resetStack() {
+    stackTop = stack.get();
+    frames.clear();
+    openUpvalues.clear();
+}
+
+void VM::interpret(VmFunction* script) {
+    // Keep the script reachable while its closure is allocated
+    push(Value(script));
+    VmClosure* closure = heap.allocate<VmClosure>(script);
+    peek(0) = Value(closure);
+    callClosure(closure, 0);
+
+    try {
+        run();
+    } catch (RuntimeError& error) {
+        Lox::runtimeError(error);
+        resetStack();
+    }
+}
+
+void VM::callValue(const Value& callee, int argCount) {
+    if (callee.isClosure()) {
+        callClosure(callee.getClosure(), argCount);
+        return;
+    }
+
+    if (callee.isBoundMethod()) {
+        // The receiver takes the callee's slot, where the method expects "this"
+        LoxBoundMethod* bound = callee.getBoundMethod();
+        stackTop[-argCount - 1] = bound->receiver;
+        callClosure(static_cast<VmClosure*>(bound->method), argCount);
+        return;
+    }
+
+    if (callee.isClass()) {
+        // The class stays in its slot, and so reachable, until the new
+        // instance replaces it as the initializer's receiver
+        LoxClass* klass = callee.getClass();
+        LoxInstance* instance = heap.allocate<LoxInstance>(klass->instanceShape());
+        stackTop[-argCount - 1] = Value(instance);
+        if (klass->initializer != nullptr) {
+            callClosure(static_cast<VmClosure*>(klass->initializer), argCount);
+        } else if (argCount != 0) {
+            throw error("Expected 0 arguments but got " + std::to_string(argCount) + ".");
+        }
+        return;
+    }
+
+    if (!callee.isCallable()) {
+        throw error("Can only call functions and classes.");
+    }
+
+    LoxCallable* function = callee.getCallable();
+    if (argCount != function->arity()) {
+        throw error("Expected " + std::to_string(function->arity()) +
+            " arguments but got " + std::to_string(argCount) + ".");
+    }
+
+    // Native functions don't need an Interpreter, and read their arguments
+    // where they are
+    Value result;
+    try {
+        result = function->call(nullptr, stackTop - argCount);
+    } catch (NativeError& nativeError) {
+        throw error(nativeError.what());
+    }
+    stackTop -= argCount + 1;
+    push(result);
+}
+
+void VM::callClosure(VmClosure* closure, int argCount) {
+    if (argCount != closure->function->arity) {
+        throw error("Expected " + std::to_string(closure->function->arity) +
+            " arguments but got " + std::to_string(argCount) + ".");
+    }
+
+    if (frames.size() == maxFrames) {
+        throw stackOverflow();
+    }
+
+    frames.push_back(CallFrame{closure, closure->function->chunk.code.data(), stackTop - argCount - 1});
+}
+
+void VM::growStack() {
+    size_t capacity = 2 * (stackEnd - stack.get());
+    std::unique_ptr<Value[]> grown(new Value[capacity]);
+    std::copy(stack.get(), stackTop, grown.get());
+
+    Value* oldBase = stack.get();
+    auto moved = [&](Value* slot) { return grown.get() + (slot - oldBase); };
+    for (CallFrame& frame : frames) {
+        frame.slots = moved(frame.slots);
+    }
+    for (VmUpvalue* upvalue : openUpvalues) {
+        upvalue->location = moved(upvalue->location);
+    }
+    stackTop = moved(stackTop);
+    stackEnd = grown.get() + capacity;
+    stack = std::move(grown);
+}
+
+void VM::invoke(const Value& name, int argCount, PropertyCache& cache) {
+    Value receiver = peek(argCount);
+    if (!receiver.isInstance()) {
+        throw error("Only instances have properties.");
+    }
+
+    Value property;
+    switch (receiver.getInstance()->getProperty(name.getString(), cache, property)) {
+        case PropertyKind::METHOD:
+            callClosure(static_cast<VmClosure*>(property.asObj()), argCount);
+            return;
+        case PropertyKind::FIELD:
+            // A function stored in a field is called like any other value
+            stackTop[-argCount - 1] = property;
+            callValue(property, argCount);
+            return;
+        default:
+            throw error("Undefined property '" + name.getString() + "'.");
+    }
+}
+
+void VM::replaceFrame(size_t callerDepth) {
+    CallFrame& caller = frames[callerDepth - 1];
+    closeUpvalues(caller.slots);
+
+    if (frames.size() == callerDepth) {
+        // Natives and classes without an initializer leave their result
+        // behind, which the caller returns as is
+        *caller.slots = stackTop[-1];
+        stackTop = caller.slots + 1;
+        frames.pop_back();
+        return;
+    }
+
+    // The callee and its arguments slide down over the caller's frame
+    CallFrame callee = frames.back();
+    stackTop = std::copy(callee.slots, stackTop, caller.slots);
+    callee.slots = caller.slots;
+    frames.pop_back();
+    frames.back() = callee;
+}
+
+VmUpvalue* VM::captureUpvalue(Value* local) {
+    // Reuse an existing upvalue so every closure sees the same variable
+    auto it = openUpvalues.end();
+    while (it != openUpvalues.begin() && (*(it - 1))->location >= local) {
+        --it;
+        if ((*it)->location == local) {
+            return *it;
+        }
+    }
+
+    VmUpvalue* upvalue = heap.allocate<VmUpvalue>(local);
+    openUpvalues.insert(it, upvalue);
+    return upvalue;
+}
+
+void VM::closeUpvalues(Value* last) {
+    while (!openUpvalues.empty() && openUpvalues.back()->location >= last) {
+        openUpvalues.back()->close();
+        openUpvalues.pop_back();
+    }
+}
+
+int VM::currentLine() const {
+    return frameLine(frames.back());
+}
+
+int VM::frameLine(const CallFrame& frame) const {
+    const Chunk& chunk = frame.closure->function->chunk;
+    size_t offset = frame.ip - chunk.code.data() - 1;
+    return chunk.lines[offset];
+}
+
+RuntimeError VM::error(const string& message) const {
+    return RuntimeError(currentLine(), message);
+}
+
+RuntimeError VM::stackOverflow() const {
+    RuntimeError overflow = error("Stack overflow.");
+    for (size_t i = frames.size(); i > 0; i--) {
+        const CallFrame& frame = frames[i - 1];
+        // The script is always the outermost frame
+        overflow.addTraceFrame(frameLine(frame), i > 1 ? frame.closure->function->name : "");
+    }
+    return overflow;
+}
+
+void VM::run() {
+    CallFrame* frame = &frames.back();
+    const uint8_t* ip = frame->ip;
+    const Value* constants = frame->closure->function->chunk.constants.data();
+    PropertyCache* caches = frame->closure->function->chunk.caches.data();
+
+#define READ_BYTE() (*ip++)
+#define READ_SHORT() (ip += 2, static_cast<uint16_t>((ip[-2] << 8) | ip[-1]))
+// The frame's ip is only synced before anything that may inspect it
+#define SAVE_IP() (frame->ip = ip)
+#define LOAD_FRAME() \
+    do { \
+        frame = &frames.back(); \
+        ip = frame->ip; \
+        constants = frame->closure->function->chunk.constants.data(); \
+        caches = frame->closure->function->chunk.caches.data(); \
+    } while (false)
+#define RUNTIME_ERROR(message) \
+    do { \
+        SAVE_IP(); \
+        throw error(message); \
+    } while (false)
+#define NUMBER_OPERANDS() \
+    do { \
+        if (!peek(0).isNumber() || !peek(1).isNumber()) { \
+            RUNTIME_ERROR("Operands must be numbers."); \
+        } \
+    } while (false)
+#define BINARY_OP(op) \
+    do { \
+        NUMBER_OPERANDS(); \
+        double b = pop().getNumber(); \
+        Value& a = peek(0); \
+        a = Value(a.getNumber() op b); \
+    } while (false)
+
+#if USE_COMPUTED_GOTO
+    static void* dispatchTable[] = {
+#define OPCODE_LABEL(name) &&L_##name,
+        OPCODE_LIST(OPCODE_LABEL)
+#undef OPCODE_LABEL
+    };
+#define INTERPRET_LOOP DISPATCH();
+#define CASE(name) L_##name:
+#define DISPATCH() goto *dispatchTable[READ_BYTE()]
+#else
+#define INTERPRET_LOOP for (;;) switch (READ_BYTE())
+#define CASE(name) case OP_##name:
+#define DISPATCH() break
+#endif
+
+    INTERPRET_LOOP
+    {
+        CASE(CONSTANT) {
+            push(constants[READ_SHORT()]);
+            DISPATCH();
+        }
+        CASE(NIL) {
+            push(Value());
+            DISPATCH();
+        }
+        CASE(TRUE) {
+            push(Value(true));
+            DISPATCH();
+        }
+        CASE(FALSE) {
+            push(Value(false));
+            DISPATCH();
+        }
+        CASE(POP) {
+            stackTop--;
+            DISPATCH();
+        }
+        CASE(GET_LOCAL) {
+            push(frame->slots[READ_BYTE()]);
+            DISPATCH();
+        }
+        CASE(SET_LOCAL) {
+            frame->slots[READ_BYTE()] = peek(0);
+            DISPATCH();
+        }
+        CASE(GET_GLOBAL) {
+            uint16_t index = READ_SHORT();
+            if (!globalDefined[index]) {
+                RUNTIME_ERROR("Undefined variable '" + globalNames[index] + "'.");
+            }
+            push(globalValues[index]);
+            DISPATCH();
+        }
+        CASE(DEFINE_GLOBAL) {
+            uint16_t index = READ_SHORT();
+            globalValues[index] = pop();
+            globalDefined[index] = true;
+            DISPATCH();
+        }
+        CASE(SET_GLOBAL) {
+            uint16_t index = READ_SHORT();
+            if (!globalDefined[index]) {
+                RUNTIME_ERROR("Undefined variable '" + globalNames[index] + "'.");
+            }
+            globalValues[index] = peek(0);
+            DISPATCH();
+        }
+        CASE(GET_UPVALUE) {
+            push(*frame->closure->upvalues[READ_BYTE()]->location);
+            DISPATCH();
+        }
+        CASE(SET_UPVALUE) {
+            *frame->closure->upvalues[READ_BYTE()]->location = peek(0);
+            DISPATCH();
+        }
+        CASE(EQUAL) {
+            bool equal = peek(1).equals(peek(0));
+            stackTop--;
+            peek(0) = Value(equal);
+            DISPATCH();
+        }
+        CASE(NOT_EQUAL) {
+            bool equal = peek(1).equals(peek(0));
+            stackTop--;
+            peek(0) = Value(!equal);
+            DISPATCH();
+        }
+        CASE(GREATER) {
+            BINARY_OP(>);
+            DISPATCH();
+        }
+        CASE(GREATER_EQUAL) {
+            BINARY_OP(>=);
+            DISPATCH();
+        }
+        CASE(LESS) {
+            BINARY_OP(<);
+            DISPATCH();
+        }
+        CASE(LESS_EQUAL) {
+            BINARY_OP(<=);
+            DISPATCH();
+        }
+        CASE(ADD) {
+            Value& a = peek(1);
+            const Value& b = peek(0);
+            if (a.isNumber() && b.isNumber()) {
+                a = Value(a.getNumber() + b.getNumber());
+            } else if (a.isString() && b.isString()) {
+                a = Value::concatenate(a, b);
+            } else {
+                RUNTIME_ERROR("Operands must be two numbers or two strings.");
+            }
+            stackTop--;
+            DISPATCH();
+        }
+        CASE(SUBTRACT) {
+            BINARY_OP(-);
+            DISPATCH();
+        }
+        CASE(MULTIPLY) {
+            BINARY_OP(*);
+            DISPATCH();
+        }
+        CASE(DIVIDE) {
+            NUMBER_OPERANDS();
+            if (peek(0).getNumber() == 0) {
+                RUNTIME_ERROR("Division by zero.");
+            }
+            BINARY_OP(/);
+            DISPATCH();
+        }
+        CASE(NOT) {
+            peek(0) = Value(!peek(0).isTruthy());
+            DISPATCH();
+        }
+        CASE(NEGATE) {
+            if (!peek(0).isNumber()) {
+                RUNTIME_ERROR("Operand must be a number.");
+            }
+            peek(0) = Value(-peek(0).getNumber());
+            DISPATCH();
+        }
+        CASE(PRINT) {
+            Output::print(pop());
+            DISPATCH();
+        }
+        CASE(JUMP) {
+            uint16_t offset = READ_SHORT();
+            ip += offset;
+            DISPATCH();
+        }
+        CASE(JUMP_IF_FALSE) {
+            uint16_t offset = READ_SHORT();
+            if (!peek(0).isTruthy()) ip += offset;
+            DISPATCH();
+        }
+        CASE(JUMP_IF_TRUE) {
+            uint16_t offset = READ_SHORT();
+            if (peek(0).isTruthy()) ip += offset;
+            DISPATCH();
+        }
+        CASE(LOOP) {
+            uint16_t offset = READ_SHORT();
+            ip -= offset;
+            DISPATCH();
+        }
+        CASE(CALL) {
+            int argCount = READ_BYTE();
+            SAVE_IP();
+            callValue(peek(argCount), argCount);
+            LOAD_FRAME();
+            DISPATCH();
+        }
+        CASE(TAIL_CALL) {
+            int argCount = READ_BYTE();
+            SAVE_IP();
+            size_t depth = frames.size();
+            callValue(peek(argCount), argCount);
+            replaceFrame(depth);
+            if (frames.empty()) {
+                return;
+            }
+
+            LOAD_FRAME();
+            DISPATCH();
+        }
+        CASE(CLOSURE) {
+            VmFunction* function = frame->closure->function->chunk.functions[READ_SHORT()];
+            VmClosure* closure = heap.allocate<VmClosure>(function);
+            // Pushed before capturing, which may allocate
+            push(Value(closure));
+            for (int i = 0; i < function->upvalueCount; i++) {
+                uint8_t isLocal = READ_BYTE();
+                uint8_t index = READ_BYTE();
+                if (isLocal) {
+                    closure->upvalues.push_back(captureUpvalue(frame->slots + index));
+                } else {
+                    closure->upvalues.push_back(frame->closure->upvalues[index]);
+                }
+            }
+            DISPATCH();
+        }
+        CASE(CLOSE_UPVALUE) {
+            closeUpvalues(stackTop - 1);
+            stackTop--;
+            DISPATCH();
+        }
+        CASE(RETURN) {
+            // The result replaces the callee in the caller's frame
+            closeUpvalues(frame->slots);
+            *frame->slots = stackTop[-1];
+            stackTop = frame->slots + 1;
+            frames.pop_back();
+            if (frames.empty()) {
+                return;
+            }
+
+            LOAD_FRAME();
+            DISPATCH();
+        }
+        CASE(CLASS) {
+            push(Value(heap.allocate<LoxClass>(constants[READ_SHORT()].getString())));
+            DISPATCH();
+        }
+        CASE(INHERIT) {
+            if (!peek(1).isClass()) {
+                RUNTIME_ERROR("Superclass must be a class.");
+            }
+            peek(0).getClass()->inherit(peek(1).getClass());
+            stackTop--;
+            DISPATCH();
+        }
+        CASE(METHOD) {
+            // Name constants are always interned strings
+            ObjString* name = static_cast<ObjString*>(constants[READ_SHORT()].asObj());
+            peek(1).getClass()->addMethod(name, peek(0).asObj());
+            stackTop--;
+            DISPATCH();
+        }
+        CASE(GET_PROPERTY) {
+            const Value& name = constants[READ_SHORT()];
+            PropertyCache& cache = caches[READ_SHORT()];
+            if (!peek(0).isInstance()) {
+                RUNTIME_ERROR("Only instances have properties.");
+            }
+
+            Value property;
+            PropertyKind kind = peek(0).getInstance()->getProperty(name.getString(), cache, property);
+            if (kind == PropertyKind::FIELD) {
+                peek(0) = property;
+            } else if (kind == PropertyKind::METHOD) {
+                // The instance stays on the stack while the bound method is allocated
+                peek(0) = Value(heap.allocate<LoxBoundMethod>(peek(0), property.asObj()));
+            } else {
+                RUNTIME_ERROR("Undefined property '" + name.getString() + "'.");
+            }
+            DISPATCH();
+        }
+        CASE(SET_PROPERTY) {
+            const Value& name = constants[READ_SHORT()];
+            PropertyCache& cache = caches[READ_SHORT()];
+            if (!peek(1).isInstance()) {
+                RUNTIME_ERROR("Only instances have fields.");
+            }
+
+            peek(1).getInstance()->setProperty(name.getString(), peek(0), cache);
+            Value value = pop();
+            peek(0) = value;
+            DISPATCH();
+        }
+        CASE(INVOKE) {
+            const Value& name = constants[READ_SHORT()];
+            int argCount = READ_BYTE();
+            PropertyCache& cache = caches[READ_SHORT()];
+            SAVE_IP();
+            invoke(name, argCount, cache);
+            LOAD_FRAME();
+            DISPATCH();
+        }
+        CASE(TAIL_INVOKE) {
+            const Value& name = constants[READ_SHORT()];
+            int argCount = READ_BYTE();
+            PropertyCache& cache = caches[READ_SHORT()];
+            SAVE_IP();
+            size_t depth = frames.size();
+            invoke(name, argCount, cache);
+            replaceFrame(depth);
+            if (frames.empty()) {
+                return;
+            }
+
+            LOAD_FRAME();
+            DISPATCH();
+        }
+        CASE(GET_SUPER) {
+            ObjString* name = static_cast<ObjString*>(constants[READ_SHORT()].asObj());
+            // The superclass stays reachable through the "super" variable
+            LoxClass* superclass = pop().getClass();
+            Obj* method = superclass->findMethod(name);
+            if (method == nullptr) {
+                RUNTIME_ERROR("Undefined property '" + name->chars + "'.");
+            }
+            peek(0) = Value(heap.allocate<LoxBoundMethod>(peek(0), method));
+            DISPATCH();
+        }
+        CASE(SUPER_INVOKE) {
+            ObjString* name = static_cast<ObjString*>(constants[READ_SHORT()].asObj());
+            int argCount = READ_BYTE();
+            LoxClass* superclass = pop().getClass();
+            Obj* method = superclass->findMethod(name);
+            if (method == nullptr) {
+                RUNTIME_ERROR("Undefined property '" + name->chars + "'.");
+            }
+            SAVE_IP();
+            callClosure(static_cast<VmClosure*>(method), argCount);
+            LOAD_FRAME();
+            DISPATCH();
+        }
+        CASE(LIST) {
+            push(Value(heap.allocate<LoxList>()));
+            DISPATCH();
+        }
+        CASE(APPEND) {
+            int count = READ_BYTE();
+            LoxList* list = peek(count).getList();
+            for (Value* element = stackTop - count; element < stackTop; element++) {
+                list->push(*element);
+            }
+            stackTop -= count;
+            DISPATCH();
+        }
+        CASE(MAP) {
+            push(Value(heap.allocate<LoxMap>()));
+            DISPATCH();
+        }
+        CASE(INSERT) {
+            int count = READ_BYTE();
+            LoxMap* map = peek(count * 2).getMap();
+            for (Value* entry = stackTop - count * 2; entry < stackTop; entry += 2) {
+                map->set(entry[0], entry[1]);
+            }
+            stackTop -= count * 2;
+            DISPATCH();
+        }
+        CASE(GET_INDEX) {
+            Value element;
+            if (const char* message = getIndex(peek(1), peek(0), element)) {
+                RUNTIME_ERROR(message);
+            }
+            stackTop--;
+            peek(0) = element;
+            DISPATCH();
+        }
+        CASE(SET_INDEX) {
+            if (const char* message = setIndex(peek(2), peek(1), peek(0))) {
+                RUNTIME_ERROR(message);
+            }
+            stackTop[-3] = peek(0);
+            stackTop -= 2;
+            DISPATCH();
+        }
+        CASE(ITERATE) {
+            // The sequence stays on the stack while a map's keys are copied out
+            LoxList* list = iterationList(peek(0));
+            if (list == nullptr) {
+                RUNTIME_ERROR("Can only iterate over lists and maps.");
+            }
+            peek(0) = Value(list);
+            DISPATCH();
+        }
+        CASE(FOR_ITER) {
+            Value* slots = frame->slots + READ_BYTE();
+            uint16_t offset = READ_SHORT();
+            // Checked against the length every time since the body may change the list
+            const vector<Value>& elements = static_cast<LoxList*>(slots[0].asObj())->elements;
+            size_t position = static_cast<size_t>(slots[1].asNumber());
+            if (position < elements.size()) {
+                slots[1] = Value(static_cast<double>(position + 1));
+                push(elements[position]);
+            } else {
+                ip += offset;
+            }
+            DISPATCH();
+        }
+    }
+
+#undef READ_BYTE
+#undef READ_SHORT
+#undef SAVE_IP
+#undef LOAD_FRAME
+#undef RUNTIME_ERROR
+#undef NUMBER_OPERANDS
+#undef BINARY_OP
+#undef INTERPRET_LOOP
+#undef CASE
+#undef DISPATCH
+}
@@ -0,0 +1,91 @@
+#ifndef VM_H
+#define VM_H
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Value.h"
+#include "VmFunction.h"
+#include "Heap.h"
+
+class RuntimeError;
+
+// Stack-based bytecode interpreter, the alternative to the tree-walking
+// Interpreter. Programs are lowered by the Compiler first.
+class VM : public GcRootSource {
+public:
+    // Lox calls may nest maxCallDepth deep before raising a stack overflow
+    explicit VM(size_t maxCallDepth);
+    ~VM();
+
+    // Runs a compiled top-level function, reporting any runtime error
+    void interpret(VmFunction* script);
+
+    // Index of a global variable, allocated on first use by the Compiler
+    int globalSlot(const std::string& name);
+
+    // The stack, globals and open upvalues
+    void markRoots(Heap& heap) override;
+
+private:
+    struct CallFrame {
+        VmClosure* closure;
+        const uint8_t* ip;
+        Value* slots;  // First stack slot of the frame, holding the callee
+    };
+
+    static const int INITIAL_STACK_SLOTS = 4096;
+
+    Heap& heap;
+    size_t maxFrames;  // The script's frame plus the calls allowed
+    // Grows when a push finds it full, so deep limits cost nothing until a
+    // program actually recurses that deep. A frame's temporaries have no
+    // fixed bound, so no amount of room set aside at a call would do.
+    std::unique_ptr<Value[]> stack;
+    Value* stackEnd;
+    Value* stackTop;
+    std::vector<CallFrame> frames;
+
+    // Globals are addressed by index; the names are kept for error messages
+    std::unordered_map<std::string, int> globalIndices;
+    std::vector<std::string> globalNames;
+    std::vector<Value> globalValues;
+    std::vector<bool> globalDefined;
+
+    // Upvalues still pointing into the stack, ordered by slot address
+    std::vector<VmUpvalue*> openUpvalues;
+
+    void run();
+    void resetStack();
+
+    // Takes a copy, since the value may come from the stack it grows
+    void push(Value value) {
+        if (stackTop == stackEnd) growStack();
+        *stackTop++ = value;
+    }
+    Value pop() { return *--stackTop; }
+    Value& peek(int distance) { return stackTop[-1 - distance]; }
+
+    void callValue(const Value& callee, int argCount);
+    void callClosure(VmClosure* closure, int argCount);
+    // Moves the stack to one twice the size, repointing the frames and the
+    // open upvalues. Values held by reference into the old one dangle, so
+    // nothing may hold one across a push.
+    void growStack();
+    void invoke(const Value& name, int argCount, PropertyCache& cache);
+    // Finishes a call made in tail position by the frame at callerDepth - 1:
+    // a new frame takes that frame's place on the stack, and a call that
+    // already finished returns its result from it
+    void replaceFrame(size_t callerDepth);
+    VmUpvalue* captureUpvalue(Value* local);
+    void closeUpvalues(Value* last);
+
+    int currentLine() const;
+    int frameLine(const CallFrame& frame) const;
+    RuntimeError error(const std::string& message) const;
+    // Reports every frame on the stack, innermost first
+    RuntimeError stackOverflow() const;
+};
+
+#endif // VM_H
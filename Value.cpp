@@ -1,18 +1,99 @@
 #include "Value.h"
+#include "Heap.h"
 #include "LoxCallable.h"
+#include "LoxClass.h"
+#include "LoxCollections.h"
+#include "VmFunction.h"
+#include <charconv>
+
+Value::Value(std::string val) : Value(Heap::instance().intern(std::move(val))) {}
+
+size_t Value::stringLength() const {
+    if (isObjType(OBJ_ROPE)) return static_cast<ObjRope*>(asObj())->length;
+    return static_cast<ObjString*>(asObj())->chars.size();
+}
+
+Value Value::concatenate(const Value& left, const Value& right) {
+    size_t leftLength = left.stringLength();
+    size_t rightLength = right.stringLength();
+    if (leftLength == 0) return right;
+    if (rightLength == 0) return left;
+
+    size_t length = leftLength + rightLength;
+    if (length < ObjRope::MIN_LENGTH) {
+        std::string chars;
+        chars.reserve(length);
+        chars += left.getString();
+        chars += right.getString();
+        return Value(Heap::instance().intern(std::move(chars)));
+    }
+    return Value(Heap::instance().allocate<ObjRope>(left.asObj(), right.asObj(), length));
+}
+
+LoxCallable* Value::getCallable() const {
+    if (!isCallable()) throw std::runtime_error("Expected callable.");
+    return static_cast<LoxCallable*>(asObj());
+}
+
+VmClosure* Value::getClosure() const {
+    if (!isClosure()) throw std::runtime_error("Expected closure.");
+    return static_cast<VmClosure*>(asObj());
+}
+
+LoxClass* Value::getClass() const {
+    if (!isClass()) throw std::runtime_error("Expected class.");
+    return static_cast<LoxClass*>(asObj());
+}
+
+LoxInstance* Value::getInstance() const {
+    if (!isInstance()) throw std::runtime_error("Expected instance.");
+    return static_cast<LoxInstance*>(asObj());
+}
+
+LoxBoundMethod* Value::getBoundMethod() const {
+    if (!isBoundMethod()) throw std::runtime_error("Expected bound method.");
+    return static_cast<LoxBoundMethod*>(asObj());
+}
+
+LoxList* Value::getList() const {
+    if (!isList()) throw std::runtime_error("Expected list.");
+    return static_cast<LoxList*>(asObj());
+}
+
+LoxMap* Value::getMap() const {
+    if (!isMap()) throw std::runtime_error("Expected map.");
+    return static_cast<LoxMap*>(asObj());
+}
 
 std::string Value::toString() const {
-    if (isString()) return std::get<std::string>(data);
+    if (isString()) return getString();
     if (isNumber()) {
-        std::string text = std::to_string(std::get<double>(data));
-        // Remove trailing zeros
-        if (text.find('.') != std::string::npos) {
-            text = text.substr(0, text.find_last_not_of('0') + 1);
-            if (text.back() == '.') text = text.substr(0, text.size() - 1);
-        }
-        return text;
+        char digits[NUMBER_BUFFER_SIZE];
+        return std::string(digits, formatNumber(asNumber(), digits));
     }
-    if (isBoolean()) return std::get<bool>(data) ? "true" : "false";
-    if (isCallable()) return std::get<std::shared_ptr<LoxCallable>>(data)->toString();
+    if (isBoolean()) return getBoolean() ? "true" : "false";
+    if (isCallable()) return getCallable()->toString();
+    if (isClosure()) return getClosure()->toString();
+    if (isClass()) return getClass()->name;
+    if (isInstance()) return getInstance()->klass()->name + " instance";
+    if (isBoundMethod()) return getBoundMethod()->toString();
+    if (isList()) return getList()->toString();
+    if (isMap()) return getMap()->toString();
     return "nil";
-} 
\ No newline at end of file
+}
+
+size_t Value::formatNumber(double number, char* out) {
+    // Integers are by far the most common numbers printed. Every integer
+    // below 2^53 is exact, so those always print in full.
+    if (std::fabs(number) < 9007199254740992.0) {
+        int64_t whole = static_cast<int64_t>(number);
+        if (whole == number && !(whole == 0 && std::signbit(number))) {
+            return std::to_chars(out, out + NUMBER_BUFFER_SIZE, whole).ptr - out;
+        }
+    }
+
+    // Otherwise the shortest text that reads back as the same double, in
+    // whichever of fixed or scientific notation is shorter (0.1, 1e-07,
+    // 1.2345678901234568e+17)
+    return std::to_chars(out, out + NUMBER_BUFFER_SIZE, number).ptr - out;
+}
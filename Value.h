@@ -1,81 +1,146 @@
 #ifndef VALUE_H
 #define VALUE_H
 
+#include <cstdint>
+#include <cstring>
 #include <string>
 #include <variant>
 #include <ostream>
 #include <cmath>
 #include <stdexcept>
-#include <memory>
+#include <type_traits>
+#include "Object.h"
 
 // Forward declarations
 class LoxCallable;
+class VmClosure;
+class LoxClass;
+class LoxInstance;
+class LoxBoundMethod;
+class LoxList;
+class LoxMap;
 
-// Value class for interpreter runtime
+// Value class for interpreter runtime.
+//
+// Values are NaN-boxed into a single 64-bit word. Any double that is not a
+// quiet NaN with all of QNAN's bits set is stored as is. Otherwise the low
+// bits tag nil, false and true, and with the sign bit also set the low 48
+// bits are a pointer to a heap Obj.
 class Value {
 private:
-    std::variant<std::string, double, bool, std::monostate, std::shared_ptr<LoxCallable>> data;
+    static constexpr uint64_t SIGN_BIT = 0x8000000000000000;
+    static constexpr uint64_t QNAN = 0x7ffc000000000000;
+    static constexpr uint64_t TAG_NIL = 1;
+    static constexpr uint64_t TAG_FALSE = 2;
+    static constexpr uint64_t TAG_TRUE = 3;
+    static constexpr uint64_t NIL_BITS = QNAN | TAG_NIL;
+    static constexpr uint64_t FALSE_BITS = QNAN | TAG_FALSE;
+    static constexpr uint64_t TRUE_BITS = QNAN | TAG_TRUE;
+    static constexpr uint64_t OBJ_BITS = SIGN_BIT | QNAN;
+
+    uint64_t bits;
+
+    bool isObjType(ObjType type) const { return isObj() && asObj()->type == type; }
+    size_t stringLength() const;
 
 public:
-    // Constructors
-    Value() : data(std::monostate{}) {}
-    Value(std::string val) : data(std::move(val)) {}
-    Value(double val) : data(val) {}
-    Value(bool val) : data(val) {}
-    Value(std::monostate) : data(std::monostate{}) {}
-    Value(std::shared_ptr<LoxCallable> callable) : data(std::move(callable)) {}
+    // Constructors. Values are plain words; the heap objects they point at
+    // are owned by the garbage-collected Heap.
+    Value() : bits(NIL_BITS) {}
+    Value(std::string val);  // Interns the string on the Heap
+    Value(const char* val) : Value(std::string(val)) {}
+    Value(double val) { std::memcpy(&bits, &val, sizeof(double)); }
+    Value(bool val) : bits(val ? TRUE_BITS : FALSE_BITS) {}
+    Value(std::monostate) : bits(NIL_BITS) {}
+    Value(Obj* object) : bits(OBJ_BITS | static_cast<uint64_t>(reinterpret_cast<uintptr_t>(object))) {}
+
+    // Heap object access, used by the collector
+    bool isObj() const { return (bits & OBJ_BITS) == OBJ_BITS; }
+    Obj* asObj() const { return reinterpret_cast<Obj*>(static_cast<uintptr_t>(bits & ~OBJ_BITS)); }
 
     // Type checks
-    bool isString() const { return std::holds_alternative<std::string>(data); }
-    bool isNumber() const { return std::holds_alternative<double>(data); }
-    bool isBoolean() const { return std::holds_alternative<bool>(data); }
-    bool isNil() const { return std::holds_alternative<std::monostate>(data); }
-    bool isCallable() const { return std::holds_alternative<std::shared_ptr<LoxCallable>>(data); }
-    
+    bool isString() const {
+        return isObj() && (asObj()->type == OBJ_STRING || asObj()->type == OBJ_ROPE);
+    }
+    bool isNumber() const { return (bits & QNAN) != QNAN; }
+    bool isBoolean() const { return (bits | 1) == TRUE_BITS; }
+    bool isNil() const { return bits == NIL_BITS; }
+    bool isCallable() const { return isObjType(OBJ_CALLABLE); }
+    bool isClosure() const { return isObjType(OBJ_CLOSURE); }
+    bool isClass() const { return isObjType(OBJ_CLASS); }
+    bool isInstance() const { return isObjType(OBJ_INSTANCE); }
+    bool isBoundMethod() const { return isObjType(OBJ_BOUND_METHOD); }
+    bool isList() const { return isObjType(OBJ_LIST); }
+    bool isMap() const { return isObjType(OBJ_MAP); }
+
     // Value getters with type checking
-    std::string getString() const { 
-        if (!isString()) throw std::runtime_error("Expected string.");
-        return std::get<std::string>(data); 
+    const std::string& getString() const {
+        if (isObjType(OBJ_STRING)) return static_cast<ObjString*>(asObj())->chars;
+        if (isObjType(OBJ_ROPE)) return static_cast<ObjRope*>(asObj())->flatten();
+        throw std::runtime_error("Expected string.");
     }
-    
-    double getNumber() const { 
+
+    double getNumber() const {
         if (!isNumber()) throw std::runtime_error("Expected number.");
-        return std::get<double>(data); 
+        return asNumber();
     }
-    
-    bool getBoolean() const { 
+
+    bool getBoolean() const {
         if (!isBoolean()) throw std::runtime_error("Expected boolean.");
-        return std::get<bool>(data); 
+        return bits == TRUE_BITS;
     }
-    
-    std::shared_ptr<LoxCallable> getCallable() const {
-        if (!isCallable()) throw std::runtime_error("Expected callable.");
-        return std::get<std::shared_ptr<LoxCallable>>(data);
+
+    LoxCallable* getCallable() const;
+
+    // Closures only exist when running on the bytecode VM
+    VmClosure* getClosure() const;
+
+    LoxClass* getClass() const;
+    LoxInstance* getInstance() const;
+    LoxBoundMethod* getBoundMethod() const;
+    LoxList* getList() const;
+    LoxMap* getMap() const;
+
+    // Unchecked access for callers that have already tested the type
+    double asNumber() const {
+        double number;
+        std::memcpy(&number, &bits, sizeof(double));
+        return number;
     }
-    
+
+    // Joins two strings. Short results are interned like any other string;
+    // longer ones become a rope, so building a string piece by piece stays
+    // linear. Both operands must be reachable by the collector.
+    static Value concatenate(const Value& left, const Value& right);
+
     // Conversion to string for display
     std::string toString() const;
-    
+
+    // Writes a number the way toString shows it into out, which must hold
+    // NUMBER_BUFFER_SIZE chars, and returns the length. Integers print
+    // without a fraction; anything else gets the shortest round-trip form.
+    static constexpr size_t NUMBER_BUFFER_SIZE = 32;
+    static size_t formatNumber(double number, char* out);
+
     // Check truthiness according to Lox rules
     bool isTruthy() const {
+        if (isNumber()) return asNumber() != 0;
         if (isNil()) return false;
-        if (isBoolean()) return std::get<bool>(data);
-        if (isNumber()) return std::get<double>(data) != 0;
-        return true; // Strings and callables are always truthy
+        if (isBoolean()) return bits == TRUE_BITS;
+        return true; // Strings and every other object are always truthy
     }
-    
+
     // Equality
     bool equals(const Value& other) const {
-        if (isNil() && other.isNil()) return true;
-        if (isNumber() && other.isNumber()) 
-            return std::get<double>(data) == std::get<double>(other.data);
-        if (isString() && other.isString())
-            return std::get<std::string>(data) == std::get<std::string>(other.data);
-        if (isBoolean() && other.isBoolean())
-            return std::get<bool>(data) == std::get<bool>(other.data);
-        if (isCallable() && other.isCallable())
-            return std::get<std::shared_ptr<LoxCallable>>(data) == std::get<std::shared_ptr<LoxCallable>>(other.data);
-        return false; // Different types are never equal
+        if (isNumber() && other.isNumber())
+            return asNumber() == other.asNumber();
+        if (bits == other.bits) return true;
+        // Interned strings are equal only when they are the same object, but
+        // a rope has to be compared by its characters
+        if (isObjType(OBJ_ROPE) || other.isObjType(OBJ_ROPE))
+            return isString() && other.isString() && getString() == other.getString();
+        // nil, booleans and everything else compare by identity
+        return false;
     }
 
     // Stream output
@@ -83,10 +148,13 @@ public:
         os << v.toString();
         return os;
     }
-    
+
     // Convenience operator overloads
     bool operator==(const Value& other) const { return equals(other); }
     bool operator!=(const Value& other) const { return !equals(other); }
 };
 
-#endif // VALUE_H 
\ No newline at end of file
+static_assert(sizeof(Value) == sizeof(uint64_t), "Value must stay one machine word");
+static_assert(std::is_trivially_copyable<Value>::value, "Value must be copyable without bookkeeping");
+
+#endif // VALUE_H
@@ -0,0 +1,59 @@
+#ifndef VM_FUNCTION_H
+#define VM_FUNCTION_H
+
+#include <string>
+#include <vector>
+#include "Chunk.h"
+#include "Object.h"
+#include "Value.h"
+
+// Compiled function prototype produced by the Compiler
+class VmFunction : public Obj {
+public:
+    std::string name;
+    int arity = 0;
+    int upvalueCount = 0;
+    Chunk chunk;
+
+    explicit VmFunction(const std::string& name) : Obj(OBJ_FUNCTION), name(name) {}
+
+    void trace(Heap& heap) override;
+};
+
+// A variable captured by a closure. While the variable is still on the VM
+// stack the upvalue points at its slot; once the slot goes out of scope the
+// value is moved into the upvalue itself.
+class VmUpvalue : public Obj {
+public:
+    Value* location;
+    Value closed;
+
+    explicit VmUpvalue(Value* slot) : Obj(OBJ_UPVALUE), location(slot) {}
+
+    void close() {
+        closed = *location;
+        location = &closed;
+    }
+
+    // Open upvalues are kept alive through the stack slot they point at
+    void trace(Heap& heap) override;
+};
+
+// Runtime function object: a prototype plus the variables it captured
+class VmClosure : public Obj {
+public:
+    VmFunction* function;
+    std::vector<VmUpvalue*> upvalues;
+
+    explicit VmClosure(VmFunction* function) : Obj(OBJ_CLOSURE), function(function) {
+        upvalues.reserve(function->upvalueCount);
+    }
+
+    void trace(Heap& heap) override;
+
+    std::string toString() const {
+        return "<fn " + function->name + ">";
+    }
+};
+
+#endif // VM_FUNCTION_H
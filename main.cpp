@@ -1,16 +1,70 @@
 #include "Lox.h"
+#include "Interpreter.h"
+#include "Output.h"
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <string>
 using namespace std;
 
+static void usage() {
+    cout << "Usage: jlox [--vm] [--dump-tokens] [--dump-ast] [--dump-optimized-ast] [--gc-stats] [--gc-growth=<factor>] [--max-call-depth=<n>] [script]\n";
+    exit(65);
+}
+
 int main(int argc, char* argv[]) {
-    if(argc > 2) {
-        cout << "Usage: jlox [script]\n";
+    string script;
+    bool callDepthGiven = false;
+    for(int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if(arg == "--vm") {
+            Lox::options.useVm = true;
+        } else if(arg == "--dump-tokens") {
+            Lox::options.dumpTokens = true;
+        } else if(arg == "--dump-ast") {
+            Lox::options.dumpAst = true;
+        } else if(arg == "--dump-optimized-ast") {
+            Lox::options.dumpOptimizedAst = true;
+        } else if(arg == "--gc-stats") {
+            Lox::options.gcStats = true;
+        } else if(arg.rfind("--gc-growth=", 0) == 0) {
+            char* end;
+            double factor = strtod(arg.c_str() + strlen("--gc-growth="), &end);
+            // Anything below 1 would collect on every allocation
+            if(*end != '\0' || !(factor >= 1.0))
+                usage();
+            Lox::options.gcGrowthFactor = factor;
+        } else if(arg.rfind("--max-call-depth=", 0) == 0) {
+            char* end;
+            long depth = strtol(arg.c_str() + strlen("--max-call-depth="), &end, 10);
+            // Even on the VM, whose frames live on the heap, runaway
+            // recursion shouldn't take all of memory before it's stopped
+            if(*end != '\0' || depth < 1 || depth > 1000000)
+                usage();
+            Lox::options.maxCallDepth = depth;
+            callDepthGiven = true;
+        } else if(arg.rfind("--", 0) == 0 || !script.empty()) {
+            usage();
+        } else {
+            script = arg;
+        }
+    }
+
+    // The tree-walker's calls recurse on the native stack, which has a
+    // fixed size
+    if(callDepthGiven && !Lox::options.useVm &&
+       static_cast<size_t>(Lox::options.maxCallDepth) > Interpreter::nativeCallDepthLimit()) {
+        cerr << "--max-call-depth can be at most " << Interpreter::nativeCallDepthLimit()
+             << " without --vm, for the size of the native stack.\n";
         exit(65);
-    } else if(argc == 2) {
-        Lox::runFile(argv[1]);
+    }
+
+    Output::init();
+    Lox::configureHeap();
+    if(!script.empty()) {
+        Lox::runFile(script);
     } else {
         Lox::runPrompt();
     }
     return 0;
 }
-
@@ -0,0 +1,219 @@
+// Runs the Lox benchmark scripts under jlox and reports, for each one, the
+// median wall time over several runs, what the garbage collector allocated
+// and the peak resident set size. Results are printed one line per
+// benchmark as space-separated key=value pairs so they can be saved as a
+// baseline and compared against later.
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+using namespace std;
+
+struct Options {
+    string jlox = "bin/jlox";
+    int runs = 5;
+    string baseline;          // Compare against this file when set
+    double threshold = 10.0;  // Percent slowdown reported as a regression
+    vector<string> flags;     // Extra flags passed through to jlox
+    vector<string> scripts;
+};
+
+struct RunResult {
+    double wallMs = 0;
+    long peakRssKb = 0;
+    int exitCode = 0;
+    string gcStats;  // The [gc] line jlox printed with --gc-stats
+};
+
+// Fields of a result line, keyed by name
+using Record = map<string, string>;
+
+static void usage() {
+    cerr << "Usage: bench_runner [--jlox path] [--runs n] [--baseline file] [--threshold percent]\n"
+         << "                    [--flag jlox-flag]... script..." << endl;
+    exit(64);
+}
+
+static string benchName(const string& path) {
+    size_t slash = path.find_last_of('/');
+    string name = slash == string::npos ? path : path.substr(slash + 1);
+    size_t dot = name.rfind('.');
+    return dot == string::npos ? name : name.substr(0, dot);
+}
+
+static Record parseRecord(const string& line) {
+    Record record;
+    istringstream in(line);
+    string field;
+    while (in >> field) {
+        size_t equals = field.find('=');
+        if (equals != string::npos) {
+            record[field.substr(0, equals)] = field.substr(equals + 1);
+        }
+    }
+    return record;
+}
+
+// Runs jlox once with stdout discarded and stderr captured
+static RunResult runOnce(const Options& options, const string& script) {
+    char stderrPath[] = "/tmp/bench_runner_XXXXXX";
+    int stderrFd = mkstemp(stderrPath);
+    if (stderrFd < 0) {
+        perror("mkstemp");
+        exit(1);
+    }
+
+    vector<string> args = {options.jlox, "--gc-stats"};
+    args.insert(args.end(), options.flags.begin(), options.flags.end());
+    args.push_back(script);
+
+    auto start = chrono::steady_clock::now();
+    pid_t pid = fork();
+    if (pid == 0) {
+        int devNull = open("/dev/null", O_WRONLY);
+        dup2(devNull, STDOUT_FILENO);
+        dup2(stderrFd, STDERR_FILENO);
+
+        vector<char*> argv;
+        for (string& arg : args) argv.push_back(&arg[0]);
+        argv.push_back(nullptr);
+        execv(argv[0], argv.data());
+        perror(argv[0]);
+        _exit(127);
+    }
+
+    int status = 0;
+    struct rusage usage;
+    wait4(pid, &status, 0, &usage);
+    auto end = chrono::steady_clock::now();
+
+    RunResult result;
+    result.wallMs = chrono::duration<double, milli>(end - start).count();
+    result.peakRssKb = usage.ru_maxrss;
+    result.exitCode = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+
+    ifstream err(stderrPath);
+    string line;
+    while (getline(err, line)) {
+        if (line.rfind("[gc]", 0) == 0) result.gcStats = line;
+    }
+    close(stderrFd);
+    unlink(stderrPath);
+    return result;
+}
+
+static double median(vector<double> values) {
+    sort(values.begin(), values.end());
+    size_t middle = values.size() / 2;
+    if (values.size() % 2 == 1) return values[middle];
+    return (values[middle - 1] + values[middle]) / 2;
+}
+
+static map<string, Record> readBaseline(const string& path) {
+    map<string, Record> baseline;
+    ifstream in(path);
+    if (!in) {
+        cerr << "Cannot read baseline " << path << endl;
+        exit(66);
+    }
+
+    string line;
+    while (getline(in, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        Record record = parseRecord(line);
+        if (record.count("bench")) baseline[record["bench"]] = record;
+    }
+    return baseline;
+}
+
+int main(int argc, char* argv[]) {
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--jlox" && hasValue) {
+            options.jlox = argv[++i];
+        } else if (arg == "--runs" && hasValue) {
+            options.runs = atoi(argv[++i]);
+        } else if (arg == "--baseline" && hasValue) {
+            options.baseline = argv[++i];
+        } else if (arg == "--threshold" && hasValue) {
+            options.threshold = atof(argv[++i]);
+        } else if (arg == "--flag" && hasValue) {
+            options.flags.push_back(argv[++i]);
+        } else if (arg.rfind("--", 0) == 0) {
+            usage();
+        } else {
+            options.scripts.push_back(arg);
+        }
+    }
+    if (options.scripts.empty() || options.runs < 1) usage();
+
+    map<string, Record> baseline;
+    if (!options.baseline.empty()) baseline = readBaseline(options.baseline);
+
+    int regressions = 0;
+    for (const string& script : options.scripts) {
+        vector<double> times;
+        long peakRssKb = 0;
+        RunResult last;
+        for (int run = 0; run < options.runs; run++) {
+            last = runOnce(options, script);
+            if (last.exitCode != 0) {
+                cerr << script << ": jlox exited with status " << last.exitCode << endl;
+                return 1;
+            }
+            times.push_back(last.wallMs);
+            peakRssKb = max(peakRssKb, last.peakRssKb);
+        }
+
+        // Allocation counts are deterministic, so any run will do
+        Record gc = parseRecord(last.gcStats);
+        string name = benchName(script);
+        double medianMs = median(times);
+
+        ostringstream line;
+        line.setf(ios::fixed);
+        line.precision(3);
+        line << "bench=" << name
+             << " runs=" << options.runs
+             << " median_ms=" << medianMs
+             << " min_ms=" << *min_element(times.begin(), times.end())
+             << " objects_allocated=" << (gc.count("objects_allocated") ? gc["objects_allocated"] : "0")
+             << " bytes_allocated=" << (gc.count("bytes_allocated") ? gc["bytes_allocated"] : "0")
+             << " gc_collections=" << (gc.count("collections") ? gc["collections"] : "0")
+             << " peak_rss_kb=" << peakRssKb;
+
+        auto base = baseline.find(name);
+        if (base != baseline.end() && base->second.count("median_ms")) {
+            double baseMs = atof(base->second["median_ms"].c_str());
+            double change = baseMs > 0 ? (medianMs - baseMs) / baseMs * 100 : 0;
+            line.precision(1);
+            line << " baseline_ms=" << baseMs << " change_pct=" << showpos << change << noshowpos;
+            if (change > options.threshold) {
+                line << " REGRESSION";
+                regressions++;
+            }
+        }
+        cout << line.str() << endl;
+    }
+
+    if (regressions > 0) {
+        cerr << regressions << " benchmark(s) slower than baseline by more than "
+             << options.threshold << "%" << endl;
+        return 1;
+    }
+    return 0;
+}